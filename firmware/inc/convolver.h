@@ -0,0 +1,240 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <span>
+
+#include "fft.h"
+
+/// @brief Convolution with a long impulse response, using uniformly
+/// partitioned overlap-save FFT convolution
+/// @details The impulse response (IR) is split into partitions of
+/// PARTITION_SIZE (B) samples, and the spectrum of each one (zero-padded to 2B)
+/// is calculated when the IR is loaded. The input is collected in frames of B
+/// samples. For each frame, the spectrum of the last 2B input samples is put
+/// in a frequency-domain delay line (FDL) holding the spectra of the last
+/// frames. The output spectrum is the sum of the products of partition p's
+/// spectrum with the FDL spectrum from p frames ago, and the second half of
+/// its inverse FFT is the next B output samples.
+///
+/// This costs about (IR length / B) complex multiply-adds per sample plus two
+/// FFTs per frame, however long the IR. The latency is 2B samples: one frame
+/// to collect the input and one to do the work for it.
+///
+/// Each frame's work is a sequence of steps of about the same size: the
+/// forward FFT steps (@ref RealFft::numSteps), one per partition for the
+/// multiply-adds, and the inverse FFT steps. ProcessBlock() runs as many
+/// steps as are due for the fraction of the frame that has been processed,
+/// so the work is spread evenly over all the blocks in the next frame instead
+/// of all being done in the block that completes a frame. With 4-sample
+/// blocks, B=1024 and an IR of up to about 4.8 seconds at 48kHz, that is at
+/// most one step per block.
+///
+/// The IR spectra and the FDL are stored in the object (several megabytes),
+/// so it should be placed in SDRAM using DSY_SDRAM_BSS.
+/// @tparam PARTITION_SIZE Partition and frame size (a power of 2)
+/// @tparam MAX_PARTITIONS Maximum number of partitions in the IR
+template<size_t PARTITION_SIZE, size_t MAX_PARTITIONS>
+class PartitionedConvolver
+{
+public:
+    static constexpr size_t partitionSize = PARTITION_SIZE;
+    static constexpr size_t maxPartitions = MAX_PARTITIONS;
+
+    /// @brief Longest impulse response, in samples
+    static constexpr size_t maxLength = partitionSize * maxPartitions;
+
+    /// @brief Delay from input to output, in samples
+    static constexpr size_t latency = 2 * partitionSize;
+
+    /// @brief Initialize the convolver, with an empty impulse response
+    void Init()
+    {
+        fft.Init();
+        irPartitions = 0;
+        Reset();
+    }
+
+    /// @brief Clear the input and output (but not the impulse response)
+    void Reset()
+    {
+        std::fill(std::begin(window[0]), std::end(window[0]), 0.f);
+        std::fill(std::begin(window[1]), std::end(window[1]), 0.f);
+        std::fill(std::begin(output[0]), std::end(output[0]), 0.f);
+        std::fill(std::begin(output[1]), std::end(output[1]), 0.f);
+        std::fill(&fdlRe[0][0], &fdlRe[0][0] + maxLength, 0.f);
+        std::fill(&fdlIm[0][0], &fdlIm[0][0] + maxLength, 0.f);
+        fill = 0;
+        cur = 0;
+        fdlHead = 0;
+        jobPartitions = 0;
+        jobSteps = stepsDone = 0;
+    }
+
+    /// @brief Set the impulse response
+    /// @details Calculates the spectrum of every partition, which takes a
+    /// while (two FFTs' worth of time per partition), so this must not be
+    /// called while ProcessBlock() might be running. The convolver is reset.
+    /// The impulse response is truncated to @ref maxLength samples.
+    /// @param ir
+    void SetImpulseResponse(std::span<const float> ir)
+    {
+        ir = ir.first(std::min(ir.size(), maxLength));
+        irPartitions = (ir.size() + partitionSize - 1) / partitionSize;
+        // Use an output buffer as scratch space for the zero-padded partitions
+        float* segment = output[0];
+        for (size_t p = 0; p < irPartitions; ++p) {
+            auto part = ir.subspan(p * partitionSize,
+                                   std::min(partitionSize, ir.size() - p * partitionSize));
+            std::fill(segment, segment + fftSize, 0.f);
+            std::copy(part.begin(), part.end(), segment);
+            fft.Forward(segment, irRe[p], irIm[p]);
+        }
+        SetMaxLength(maxLength);
+        Reset();
+    }
+
+    /// @brief Return the length of the impulse response, in partitions
+    /// @return
+    size_t GetPartitions() const { return irPartitions; }
+
+    /// @brief Limit the length of the impulse response that is used
+    /// @details Shortens the IR (by whole partitions) without recalculating
+    /// anything, to save CPU time. Takes effect from the next frame.
+    /// @param samples Maximum length in samples
+    void SetMaxLength(size_t samples)
+    {
+        size_t partitions = (samples + partitionSize - 1) / partitionSize;
+        numPartitions = std::min(partitions, irPartitions);
+    }
+
+    /// @brief Process a block of samples
+    /// @param in Input samples
+    /// @param out Output samples (the same number as the input)
+    void ProcessBlock(std::span<const float> in, std::span<float> out)
+    {
+        size_t i = 0;
+        while (i < in.size()) {
+            size_t count = std::min(in.size() - i, partitionSize - fill);
+            // Each input sample goes into the second half of the current
+            // window and the first half of the next one
+            float* curWin = window[cur] + partitionSize + fill;
+            float* nextWin = window[cur ^ 1] + fill;
+            const float* outBuf = output[cur] + partitionSize + fill;
+            for (size_t n = 0; n < count; ++n) {
+                curWin[n] = nextWin[n] = in[i + n];
+                out[i + n] = outBuf[n];
+            }
+            fill += count;
+            i += count;
+
+            // Run the steps that are due by this point in the frame
+            size_t due = (jobSteps * fill + partitionSize - 1) / partitionSize;
+            while (stepsDone < due) {
+                RunStep(stepsDone++);
+            }
+
+            if (fill == partitionSize) {
+                StartFrame();
+            }
+        }
+    }
+
+protected:
+    static constexpr size_t fftSize = 2 * partitionSize;
+    using Fft = RealFft<fftSize>;
+    static constexpr unsigned fftSteps = Fft::numSteps;
+
+    /// @brief Start the work for the frame that has just been collected
+    void StartFrame()
+    {
+        fill = 0;
+        cur ^= 1;
+        fdlHead = (fdlHead == 0) ? maxPartitions - 1 : fdlHead - 1;
+        jobPartitions = numPartitions;
+        jobSteps = (jobPartitions == 0) ? 0 : 2 * fftSteps + jobPartitions;
+        stepsDone = 0;
+        if (jobSteps == 0) {
+            std::fill(std::begin(output[cur ^ 1]), std::end(output[cur ^ 1]), 0.f);
+            return;
+        }
+        // The first step reads the window that has just been filled, so
+        // do it now, before the window starts to be refilled
+        RunStep(stepsDone++);
+    }
+
+    /// @brief Run one step of the current frame's work
+    /// @details The window that was filled in the last frame is window[cur ^ 1]
+    /// and the output for the next frame goes into output[cur ^ 1].
+    /// @param step
+    void RunStep(size_t step)
+    {
+        if (step < fftSteps) {
+            fft.ForwardStep(unsigned(step), window[cur ^ 1], fdlRe[fdlHead], fdlIm[fdlHead]);
+        } else if (step < fftSteps + jobPartitions) {
+            MultiplyAdd(step - fftSteps);
+        } else {
+            fft.InverseStep(unsigned(step - fftSteps - jobPartitions), accRe, accIm,
+                            output[cur ^ 1]);
+        }
+    }
+
+    /// @brief Multiply one IR partition's spectrum by the FDL spectrum from
+    /// the matching number of frames ago, and add to the output spectrum
+    /// @param p Partition number
+    void MultiplyAdd(size_t p)
+    {
+        size_t slot = fdlHead + p;
+        if (slot >= maxPartitions) {
+            slot -= maxPartitions;
+        }
+        const float* xRe = fdlRe[slot];
+        const float* xIm = fdlIm[slot];
+        const float* hRe = irRe[p];
+        const float* hIm = irIm[p];
+        // Bin 0 holds the DC and Nyquist values, which are both real
+        float dc = xRe[0] * hRe[0];
+        float nyquist = xIm[0] * hIm[0];
+        if (p == 0) {
+            accRe[0] = dc;
+            accIm[0] = nyquist;
+            for (size_t k = 1; k < partitionSize; ++k) {
+                accRe[k] = xRe[k] * hRe[k] - xIm[k] * hIm[k];
+                accIm[k] = xRe[k] * hIm[k] + xIm[k] * hRe[k];
+            }
+        } else {
+            accRe[0] += dc;
+            accIm[0] += nyquist;
+            for (size_t k = 1; k < partitionSize; ++k) {
+                accRe[k] += xRe[k] * hRe[k] - xIm[k] * hIm[k];
+                accIm[k] += xRe[k] * hIm[k] + xIm[k] * hRe[k];
+            }
+        }
+    }
+
+    Fft fft;
+
+    float irRe[maxPartitions][partitionSize];   ///< IR partition spectra
+    float irIm[maxPartitions][partitionSize];
+    float fdlRe[maxPartitions][partitionSize];  ///< Frequency-domain delay line
+    float fdlIm[maxPartitions][partitionSize];
+    float accRe[partitionSize];                 ///< Output spectrum
+    float accIm[partitionSize];
+
+    /// @brief Input windows of 2B samples: the one being filled and the one
+    /// the current work reads from
+    float window[2][fftSize];
+
+    /// @brief Output blocks of 2B samples (the second half is used): the one
+    /// being played and the one the current work writes to
+    float output[2][fftSize];
+
+    size_t irPartitions = 0;    ///< Length of the IR
+    size_t numPartitions = 0;   ///< Length of the IR that is used
+    size_t fill = 0;            ///< Number of samples in the current frame so far
+    size_t cur = 0;             ///< Index of the window being filled and output being played
+    size_t fdlHead = 0;         ///< FDL slot holding the newest spectrum
+    size_t jobPartitions = 0;   ///< Number of partitions used for the current work
+    size_t jobSteps = 0;        ///< Number of steps in the current work
+    size_t stepsDone = 0;       ///< Number of steps of the current work that are done
+};
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <numbers>
+
+/// @brief Equal-power crossfader (dry/wet mixer) with precomputed gains
+/// @details Gives the same mix as daisysp::CrossFade in CROSSFADE_CPOW mode,
+/// but the gains are only calculated (with trig functions) when the position
+/// changes, not for every sample. Changes are ramped linearly over the next
+/// block of samples to avoid zipper noise.
+///
+/// Usage, once per block:
+/// - SetPos() if the position has changed
+/// - StartBlock()
+/// - For each sample: Step(), then Mix() for each channel
+///
+/// Cost per output sample: 2 multiply-adds, plus 2 adds per Step().
+class EqualPowerCrossFade
+{
+public:
+    /// @brief Initialize the crossfader, with no ramp to the initial position
+    /// @param pos Initial position
+    void Init(float pos = 0.5f)
+    {
+        SetPos(pos);
+        dryGain = dryEnd = dryTarget;
+        wetGain = wetEnd = wetTarget;
+        dryStep = wetStep = 0;
+    }
+
+    /// @brief Set the crossfade position
+    /// @details The gains will ramp to the new position over the next block.
+    /// @param pos Position in [0, 1]: 0 = all dry, 1 = all wet
+    void SetPos(float pos)
+    {
+        this->pos = std::clamp(pos, 0.f, 1.f);
+        float angle = this->pos * (std::numbers::pi_v<float> / 2);
+        dryTarget = std::cos(angle);
+        wetTarget = std::sin(angle);
+    }
+
+    /// @brief Return the crossfade position
+    /// @return
+    float GetPos() const { return pos; }
+
+    /// @brief Start a block of samples
+    /// @details Sets up the ramp from the current gains to the gains for the
+    /// current position, over the given number of samples.
+    /// @param numSamples
+    void StartBlock(size_t numSamples)
+    {
+        // Start each ramp from exactly where the previous one should have
+        // ended, so rounding errors don't build up
+        dryGain = dryEnd;
+        wetGain = wetEnd;
+        dryEnd = dryTarget;
+        wetEnd = wetTarget;
+        float scale = 1.f / float(numSamples);
+        dryStep = (dryEnd - dryGain) * scale;
+        wetStep = (wetEnd - wetGain) * scale;
+    }
+
+    /// @brief Advance the gain ramps by one sample
+    void Step()
+    {
+        dryGain += dryStep;
+        wetGain += wetStep;
+    }
+
+    /// @brief Mix one sample with the current gains
+    /// @param dry
+    /// @param wet
+    /// @return
+    float Mix(float dry, float wet) const { return dry * dryGain + wet * wetGain; }
+
+private:
+    float pos = 0.5f;
+    float dryTarget = 1, wetTarget = 0;     ///< Gains for the current position
+    float dryEnd = 1, wetEnd = 0;           ///< Gains at the end of the current ramp
+    float dryGain = 1, wetGain = 0;         ///< Current gains
+    float dryStep = 0, wetStep = 0;         ///< Gain increments per sample
+};
@@ -0,0 +1,286 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <numbers>
+#include <span>
+
+#include "sysutils.h"
+
+/// @brief Feedback delay network (FDN) reverb
+/// @details A set of delay lines whose outputs are damped, mixed together by
+/// a Hadamard matrix and fed back into their inputs. The mono input is fed
+/// into every line; the left output is the sum of the even lines and the
+/// right output is the sum of the odd lines.
+///
+/// The number of lines (4, 8 or 16, up to MAX_LINES) can be changed at any
+/// time, trading echo density for CPU time. The processing functions are
+/// templates on the number of lines so all the per-line loops have constant
+/// bounds and can be unrolled or vectorized, and the Hadamard matrix is
+/// applied with a fast Walsh-Hadamard transform (N log N adds, no multiplies).
+///
+/// All the delay lines share one power-of-2 sized buffer that is interleaved:
+/// each row holds one sample from every line, so one write position is used
+/// for all of them, each sample's writes go to consecutive addresses, and
+/// the read/write positions wrap around using a mask instead of a divide.
+/// The buffer is stored in the object, so it can be placed in SDRAM using
+/// DSY_SDRAM_BSS. Objects there aren't constructed, so Init() sets up
+/// everything and must be called before anything else.
+///
+/// The delay lengths are mutually prime numbers of samples at 48kHz so the
+/// echoes don't line up. At other sample rates they are scaled to keep the same
+/// times.
+/// @tparam MAX_LINES Maximum number of delay lines (a power of 2, at least 16)
+/// @tparam BUFFER_BITS Log2 of the buffer length per line
+template<size_t MAX_LINES = 16, unsigned BUFFER_BITS = 12>
+class FdnReverb
+{
+public:
+    static_assert(std::has_single_bit(MAX_LINES) && MAX_LINES >= 16);
+
+    /// @brief Buffer length per line, in samples
+    static constexpr size_t bufferSize = size_t(1) << BUFFER_BITS;
+
+    /// @brief Initialize the reverb, with the default feedback amount and
+    /// low-pass filter cutoff frequency
+    /// @param sampleRate
+    /// @param lines Number of delay lines: 4, 8 or 16
+    void Init(float sampleRate, size_t lines = 8)
+    {
+        this->sampleRate = sampleRate;
+        numLines = ClampLines(lines);
+        feedback = defaultFeedback;
+        lpFreq = defaultLpFreq;
+        std::fill(std::begin(lowpass), std::end(lowpass), 0.f);
+        std::fill(std::begin(buffer), std::end(buffer), 0.f);
+        clearPos = bufferSize;
+        pos = 0;
+        UpdateDelays();
+        SetLpFreq(lpFreq);
+        SetFeedback(feedback);
+    }
+
+    /// @brief Change the sample rate
+    /// @details If it has changed, the lines are cleared over the next few
+    /// blocks, during which the reverb output is silent.
+    /// @param sampleRate
+    void SetSampleRate(float sampleRate)
+    {
+        if (sampleRate != this->sampleRate) {
+            this->sampleRate = sampleRate;
+            Restart();
+        }
+    }
+
+    /// @brief Set the number of delay lines
+    /// @details If it has changed, the lines are cleared over the next few
+    /// blocks, during which the reverb output is silent.
+    /// @param lines 4, 8 or 16
+    void SetLines(size_t lines)
+    {
+        lines = ClampLines(lines);
+        if (lines != numLines) {
+            numLines = lines;
+            Restart();
+        }
+    }
+
+    /// @brief Return the number of delay lines
+    /// @return
+    size_t GetLines() const { return numLines; }
+
+    /// @brief Set the feedback amount
+    /// @details This has the same meaning as for daisysp::ReverbSc: the gain
+    /// of a loop through a delay line of average length, so a given feedback
+    /// amount gives about the same decay time whatever the number of lines.
+    /// Values of 1 and above are limited to give a very long decay.
+    /// @param fb
+    void SetFeedback(float fb)
+    {
+        feedback = fb;
+        fb = std::clamp(fb, 0.f, maxFeedback);
+        // Gain for each line = fb ^ (line length / reference loop length)
+        float logFb = std::log2(fb) / (refLoopTime * sampleRate);
+        // Also scale by 1/sqrt(N) to make the Hadamard matrix orthonormal
+        float scale = 1.f / std::sqrt(float(numLines));
+        for (size_t i = 0; i < numLines; ++i) {
+            gain[i] = std::exp2(logFb * float(delay[i])) * scale;
+        }
+    }
+
+    /// @brief Set the low-pass filter cutoff frequency
+    /// @param freq Cutoff frequency in Hz
+    void SetLpFreq(float freq)
+    {
+        lpFreq = freq;
+        lpCoeff = 1.f - std::exp(-2.f * std::numbers::pi_v<float> * freq / sampleRate);
+    }
+
+    /// @brief Process a block of samples
+    /// @param in Mono input
+    /// @param outL Left output
+    /// @param outR Right output
+    void ProcessBlock(std::span<const float> in, std::span<float> outL, std::span<float> outR)
+    {
+        switch (numLines) {
+        case 4:  ProcessLines<4>(in, outL, outR);  break;
+        case 8:  ProcessLines<8>(in, outL, outR);  break;
+        default: ProcessLines<16>(in, outL, outR); break;
+        }
+    }
+
+protected:
+    /// @brief Process a block of samples with a given number of lines
+    template<size_t N>
+    void ProcessLines(std::span<const float> in, std::span<float> outL, std::span<float> outR)
+    {
+        if (clearPos < bufferSize) {
+            ClearRows(in.size());
+            std::fill(outL.begin(), outL.end(), 0.f);
+            std::fill(outR.begin(), outR.end(), 0.f);
+            return;
+        }
+
+        // Keep the output level about the same whatever the number of lines
+        static constexpr float inGain = 1.f / std::sqrt(float(N));
+        for (size_t n = 0; n < in.size(); ++n) {
+            // Read and damp the delay line outputs
+            float x[N];
+            for (size_t i = 0; i < N; ++i) {
+                float delayed = buffer[((pos - delay[i]) & mask) * MAX_LINES + i];
+                lowpass[i] += lpCoeff * (delayed - lowpass[i]);
+                x[i] = lowpass[i];
+            }
+
+            // Outputs: even lines on the left, odd lines on the right
+            float left = 0, right = 0;
+            for (size_t i = 0; i < N; i += 2) {
+                left += x[i];
+                right += x[i + 1];
+            }
+            outL[n] = left;
+            outR[n] = right;
+
+            // Feedback: decay gains and Hadamard mixing, plus the input
+            for (size_t i = 0; i < N; ++i) {
+                x[i] *= gain[i];
+            }
+            Hadamard<N>(x);
+            float input = in[n] * inGain + antiDenormal;
+            float* row = &buffer[pos * MAX_LINES];
+            for (size_t i = 0; i < N; ++i) {
+                row[i] = x[i] + input;
+            }
+            pos = (pos + 1) & mask;
+        }
+    }
+
+    /// @brief Multiply a vector by an (unnormalized) Hadamard matrix in place
+    /// @details Fast Walsh-Hadamard transform: log2(N) stages of N/2 butterflies
+    template<size_t N>
+    static void Hadamard(float (&x)[N])
+    {
+        for (size_t half = 1; half < N; half *= 2) {
+            for (size_t i = 0; i < N; i += 2 * half) {
+                for (size_t j = i; j < i + half; ++j) {
+                    float a = x[j];
+                    float b = x[j + half];
+                    x[j] = a + b;
+                    x[j + half] = a - b;
+                }
+            }
+        }
+    }
+
+    /// @brief Start again after changing the number of lines or sample rate:
+    /// recalculate everything and start clearing the buffer
+    void Restart()
+    {
+        std::fill(std::begin(lowpass), std::end(lowpass), 0.f);
+        clearPos = 0;
+        UpdateDelays();
+        SetLpFreq(lpFreq);
+        SetFeedback(feedback);
+    }
+
+    /// @brief Return a valid number of lines: 4, 8 or 16
+    static constexpr size_t ClampLines(size_t lines)
+    {
+        return std::clamp(std::bit_floor(lines), size_t(4), size_t(16));
+    }
+
+    /// @brief Calculate the delay lengths for the number of lines and sample rate
+    void UpdateDelays()
+    {
+        auto delays = GetDelays(numLines);
+        for (size_t i = 0; i < numLines; ++i) {
+            float length = std::round(float(delays[i]) * sampleRate / 48000.f);
+            delay[i] = std::min(uint32_t(length), uint32_t(bufferSize - 1));
+        }
+    }
+
+    /// @brief Clear some rows of the buffer
+    /// @details Clears all of it in about 5ms of samples
+    /// @param blockSize Number of samples in the current block
+    void ClearRows(size_t blockSize)
+    {
+        size_t rows = std::min(blockSize * clearRowsPerSample, bufferSize - clearPos);
+        std::fill_n(&buffer[clearPos * MAX_LINES], rows * MAX_LINES, 0.f);
+        clearPos += rows;
+    }
+
+    /// @brief Return the delay lengths for a number of lines
+    /// @details Each set is spread over about 20-80ms at 48kHz
+    /// @param lines
+    /// @return
+    static constexpr std::span<const uint32_t> GetDelays(size_t lines)
+    {
+        switch (lines) {
+        case 4:  return delays4;
+        case 8:  return delays8;
+        default: return delays16;
+        }
+    }
+
+    static constexpr uint32_t delays4[] = { 1913, 2593, 3203, 3907 };
+    static constexpr uint32_t delays8[] = { 1433, 1741, 2099, 2417, 2729, 3061, 3371, 3691 };
+    static constexpr uint32_t delays16[] = {
+        1031, 1229, 1381, 1523, 1693, 1873, 2029, 2213,
+        2381, 2539, 2729, 2909, 3109, 3301, 3467, 3673
+    };
+    static_assert(delays4[3] < bufferSize && delays8[7] < bufferSize && delays16[15] < bufferSize);
+
+    /// @brief Loop time that the feedback amount applies to, in seconds
+    /// (about the average delay length in daisysp::ReverbSc)
+    static constexpr float refLoopTime = 0.068f;
+
+    /// @brief Feedback amount set by Init() (same default as daisysp::ReverbSc)
+    static constexpr float defaultFeedback = 0.97f;
+
+    /// @brief Low-pass filter cutoff frequency set by Init()
+    static constexpr float defaultLpFreq = 10000;
+
+    /// @brief Largest feedback amount used
+    static constexpr float maxFeedback = 0.995f;
+
+    /// @brief Number of buffer rows cleared per sample after changing the
+    /// number of lines
+    static constexpr size_t clearRowsPerSample = 16;
+
+    static constexpr size_t mask = bufferSize - 1;
+
+    float buffer[bufferSize * MAX_LINES];
+    float lowpass[MAX_LINES];   ///< Low-pass filter state for each line
+    float gain[MAX_LINES];      ///< Feedback gain for each line
+    uint32_t delay[MAX_LINES];  ///< Delay length for each line, in samples
+    size_t numLines;
+    size_t pos;                 ///< Buffer row to write next
+    size_t clearPos;            ///< Next row to clear, or bufferSize if cleared
+    float sampleRate;
+    float feedback;
+    float lpFreq;
+    float lpCoeff;
+};
@@ -0,0 +1,192 @@
+#pragma once
+
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <numbers>
+
+/// @brief Fast Fourier transform of real data, which can be run a step at a time
+/// @details Uses a complex radix-2 FFT of half the size on the even and odd
+/// samples packed together, then splits the result into the spectrum of the
+/// real signal.
+///
+/// Spectra are stored as separate real and imaginary arrays of N/2 values
+/// each, for the bins 0 to N/2-1. Bins 0 (DC) and N/2 (Nyquist) are both
+/// real, so the Nyquist value is stored in the imaginary part of bin 0.
+/// The forward transform is unscaled and the inverse is scaled by 1/N, so
+/// Inverse(Forward(x)) == x.
+///
+/// Each transform is a sequence of @ref numSteps steps, each of which does
+/// about the same amount of work (N/2 butterflies or N/2 other operations).
+/// The steps can be run one at a time, e.g. spread over several audio
+/// callbacks, using ForwardStep() and InverseStep(), or all together using
+/// Forward() and Inverse(). The work buffer must not be changed between steps.
+///
+/// Init() must be called to calculate the twiddle factor and bit-reversal
+/// tables before using any of the transforms.
+/// @tparam N Number of real samples (a power of 2, at least 8)
+template<size_t N>
+class RealFft
+{
+public:
+    static_assert(std::has_single_bit(N) && N >= 8);
+
+    static constexpr size_t size = N;
+
+    /// @brief Number of complex values in a spectrum or the work buffer
+    static constexpr size_t numBins = N / 2;
+
+    /// @brief Number of radix-2 stages in the complex FFT
+    static constexpr unsigned numStages = std::countr_zero(numBins);
+
+    /// @brief Number of steps in a transform: packing, the FFT stages and
+    /// splitting
+    static constexpr unsigned numSteps = numStages + 2;
+
+    /// @brief Calculate the tables
+    void Init()
+    {
+        for (size_t k = 0; k < numBins / 2; ++k) {
+            double angle = -2 * std::numbers::pi * double(k) / double(numBins);
+            twRe[k] = float(std::cos(angle));
+            twIm[k] = float(std::sin(angle));
+        }
+        for (size_t k = 0; k < numBins; ++k) {
+            double angle = -2 * std::numbers::pi * double(k) / double(N);
+            splitRe[k] = float(std::cos(angle));
+            splitIm[k] = float(std::sin(angle));
+            size_t rev = 0;
+            for (unsigned bit = 0; bit < numStages; ++bit) {
+                rev |= ((k >> bit) & 1) << (numStages - 1 - bit);
+            }
+            bitRev[k] = uint16_t(rev);
+        }
+    }
+
+    /// @brief Run one step of a forward transform
+    /// @param step Step number, from 0 to numSteps-1
+    /// @param in N real input samples (only used by step 0)
+    /// @param outRe Real parts of the spectrum (only used by the last step)
+    /// @param outIm Imaginary parts of the spectrum (only used by the last step)
+    void ForwardStep(unsigned step, const float* in, float* outRe, float* outIm)
+    {
+        if (step == 0) {
+            // Pack even and odd samples into complex values, in bit-reversed order
+            for (size_t n = 0; n < numBins; ++n) {
+                workRe[bitRev[n]] = in[2 * n];
+                workIm[bitRev[n]] = in[2 * n + 1];
+            }
+        } else if (step <= numStages) {
+            Stage<false>(step - 1);
+        } else {
+            // Split the complex spectrum into the real signal's spectrum:
+            // X[k] = (Z[k] + Z*[M-k]) / 2 - j W^k (Z[k] - Z*[M-k]) / 2
+            outRe[0] = workRe[0] + workIm[0];
+            outIm[0] = workRe[0] - workIm[0];
+            for (size_t k = 1; k < numBins; ++k) {
+                float aRe = workRe[k], aIm = workIm[k];
+                float bRe = workRe[numBins - k], bIm = -workIm[numBins - k];
+                float evenRe = 0.5f * (aRe + bRe), evenIm = 0.5f * (aIm + bIm);
+                float oddRe = 0.5f * (aRe - bRe), oddIm = 0.5f * (aIm - bIm);
+                // odd * -j * W^k
+                float wRe = splitRe[k], wIm = splitIm[k];
+                float tRe = oddRe * wRe - oddIm * wIm;
+                float tIm = oddRe * wIm + oddIm * wRe;
+                outRe[k] = evenRe + tIm;
+                outIm[k] = evenIm - tRe;
+            }
+        }
+    }
+
+    /// @brief Run one step of an inverse transform
+    /// @param step Step number, from 0 to numSteps-1
+    /// @param inRe Real parts of the spectrum (only used by step 0)
+    /// @param inIm Imaginary parts of the spectrum (only used by step 0)
+    /// @param out N real output samples (only used by the last step)
+    void InverseStep(unsigned step, const float* inRe, const float* inIm, float* out)
+    {
+        if (step == 0) {
+            // Merge the real signal's spectrum into a complex spectrum, in
+            // bit-reversed order: Z[k] = E[k] + j O[k] where
+            // E[k] = (X[k] + X*[M-k]) / 2, O[k] = (X[k] - X*[M-k]) W^-k / 2
+            workRe[0] = 0.5f * (inRe[0] + inIm[0]);
+            workIm[0] = 0.5f * (inRe[0] - inIm[0]);
+            for (size_t k = 1; k < numBins; ++k) {
+                float aRe = inRe[k], aIm = inIm[k];
+                float bRe = inRe[numBins - k], bIm = -inIm[numBins - k];
+                float evenRe = 0.5f * (aRe + bRe), evenIm = 0.5f * (aIm + bIm);
+                float dRe = 0.5f * (aRe - bRe), dIm = 0.5f * (aIm - bIm);
+                // d * W^-k
+                float wRe = splitRe[k], wIm = -splitIm[k];
+                float oddRe = dRe * wRe - dIm * wIm;
+                float oddIm = dRe * wIm + dIm * wRe;
+                workRe[bitRev[k]] = evenRe - oddIm;
+                workIm[bitRev[k]] = evenIm + oddRe;
+            }
+        } else if (step <= numStages) {
+            Stage<true>(step - 1);
+        } else {
+            // Unpack the complex values into even and odd samples, and scale
+            static constexpr float scale = 1.f / float(numBins);
+            for (size_t n = 0; n < numBins; ++n) {
+                out[2 * n] = workRe[n] * scale;
+                out[2 * n + 1] = workIm[n] * scale;
+            }
+        }
+    }
+
+    /// @brief Run a whole forward transform
+    /// @param in N real input samples
+    /// @param outRe Real parts of the spectrum
+    /// @param outIm Imaginary parts of the spectrum
+    void Forward(const float* in, float* outRe, float* outIm)
+    {
+        for (unsigned step = 0; step < numSteps; ++step) {
+            ForwardStep(step, in, outRe, outIm);
+        }
+    }
+
+    /// @brief Run a whole inverse transform
+    /// @param inRe Real parts of the spectrum
+    /// @param inIm Imaginary parts of the spectrum
+    /// @param out N real output samples
+    void Inverse(const float* inRe, const float* inIm, float* out)
+    {
+        for (unsigned step = 0; step < numSteps; ++step) {
+            InverseStep(step, inRe, inIm, out);
+        }
+    }
+
+private:
+    /// @brief One radix-2 decimation-in-time stage of the complex FFT
+    /// @tparam INVERSE true to use conjugate twiddle factors
+    /// @param stage Stage number, from 0 to numStages-1
+    template<bool INVERSE>
+    void Stage(unsigned stage)
+    {
+        const size_t half = size_t(1) << stage;
+        const size_t twStride = numBins / (2 * half);
+        for (size_t group = 0; group < numBins; group += 2 * half) {
+            for (size_t k = 0; k < half; ++k) {
+                float wRe = twRe[k * twStride];
+                float wIm = INVERSE ? -twIm[k * twStride] : twIm[k * twStride];
+                size_t i = group + k, j = i + half;
+                float tRe = workRe[j] * wRe - workIm[j] * wIm;
+                float tIm = workRe[j] * wIm + workIm[j] * wRe;
+                workRe[j] = workRe[i] - tRe;
+                workIm[j] = workIm[i] - tIm;
+                workRe[i] += tRe;
+                workIm[i] += tIm;
+            }
+        }
+    }
+
+    float workRe[numBins];          ///< Complex FFT work buffer (real parts)
+    float workIm[numBins];          ///< Complex FFT work buffer (imaginary parts)
+    float twRe[numBins / 2];        ///< Complex FFT twiddle factors
+    float twIm[numBins / 2];
+    float splitRe[numBins];         ///< Real/complex split twiddle factors
+    float splitIm[numBins];
+    uint16_t bitRev[numBins];       ///< Bit-reversed indexes
+};
@@ -0,0 +1,212 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <numbers>
+#include <span>
+#include <type_traits>
+
+// Simple filters for smoothing CV and other control signals
+//
+// Each filter does a fixed amount of work per update, with no loops or
+// data-dependent branches, so the cost per audio block is known in advance.
+// Filters can be updated once per sample or once per audio block. For
+// block-rate updates, initialize the filter with the block rate instead of the
+// sample rate.
+
+/// @brief One-pole low-pass filter
+/// @details y += a * (x - y). Cost: 1 multiply-add per update.
+class OnePoleFilter
+{
+public:
+    /// @brief Initialize the filter
+    /// @param cutoffHz Cutoff frequency in Hz
+    /// @param updateRate Rate at which Process() will be called, in Hz
+    /// @param initVal Initial output value
+    void Init(float cutoffHz, float updateRate, float initVal = 0)
+    {
+        SetCutoff(cutoffHz, updateRate);
+        Reset(initVal);
+    }
+
+    /// @brief Set the cutoff frequency
+    /// @param cutoffHz Cutoff frequency in Hz
+    /// @param updateRate Rate at which Process() will be called, in Hz
+    void SetCutoff(float cutoffHz, float updateRate)
+    {
+        coeff = 1.f - std::exp(-2.f * std::numbers::pi_v<float> * cutoffHz / updateRate);
+    }
+
+    /// @brief Set the filter output to a value, with no smoothing
+    /// @param val
+    void Reset(float val) { value = val; }
+
+    /// @brief Return the current filter output
+    /// @return
+    float GetValue() const { return value; }
+
+    /// @brief Update the filter with a new input value
+    /// @param in
+    /// @return Filtered value
+    float Process(float in) { return value += coeff * (in - value); }
+
+    /// @brief Filter a block of values in place
+    /// @param buf
+    void ProcessBlock(std::span<float> buf)
+    {
+        for (auto&& val : buf) {
+            val = Process(val);
+        }
+    }
+
+private:
+    float coeff = 1;
+    float value = 0;
+};
+
+/// @brief Adaptive low-pass filter for noisy control signals ("1-euro filter")
+/// @details The cutoff frequency rises with the rate of change of the input, so
+/// there is little jitter when the input is steady and little lag when it is
+/// changing quickly.
+/// Cost: 1 divide and about 10 other floating-point operations per update.
+///
+/// Acknowledgements
+/// ----------------
+/// Gery Casiez, Nicolas Roussel, Daniel Vogel - "1 Euro Filter: A Simple
+/// Speed-based Low-pass Filter for Noisy Input in Interactive Systems" (CHI 2012)
+class OneEuroFilter
+{
+public:
+    /// @brief Initialize the filter
+    /// @param updateRate Rate at which Process() will be called, in Hz
+    /// @param minCutoffHz Cutoff frequency when the input is steady, in Hz
+    /// (lower means less jitter)
+    /// @param beta How much the cutoff frequency rises with the input's rate of
+    /// change, in Hz per (input unit per second) (higher means less lag)
+    /// @param derivCutoffHz Cutoff frequency for smoothing the rate of change, in Hz
+    /// @param initVal Initial output value
+    void Init(float updateRate, float minCutoffHz, float beta,
+              float derivCutoffHz = 1.f, float initVal = 0)
+    {
+        rate = updateRate;
+        minCutoff = minCutoffHz;
+        this->beta = beta;
+        derivCoeff = CalcCoeff(derivCutoffHz);
+        Reset(initVal);
+    }
+
+    /// @brief Set the filter output to a value, with no smoothing
+    /// @param val
+    void Reset(float val)
+    {
+        value = val;
+        prevIn = val;
+        deriv = 0;
+    }
+
+    /// @brief Return the current filter output
+    /// @return
+    float GetValue() const { return value; }
+
+    /// @brief Update the filter with a new input value
+    /// @param in
+    /// @return Filtered value
+    float Process(float in)
+    {
+        deriv += derivCoeff * ((in - prevIn) * rate - deriv);
+        prevIn = in;
+        float coeff = CalcCoeff(minCutoff + beta * std::abs(deriv));
+        return value += coeff * (in - value);
+    }
+
+    /// @brief Filter a block of values in place
+    /// @param buf
+    void ProcessBlock(std::span<float> buf)
+    {
+        for (auto&& val : buf) {
+            val = Process(val);
+        }
+    }
+
+private:
+    /// @brief Calculate the smoothing coefficient for a cutoff frequency
+    /// @details Uses alpha = 1 / (1 + tau / T) where tau = 1 / (2 pi f) and T
+    /// is the update period.
+    /// @param cutoffHz
+    /// @return
+    float CalcCoeff(float cutoffHz) const
+    {
+        float x = 2.f * std::numbers::pi_v<float> * cutoffHz;
+        return x / (x + rate);
+    }
+
+    float rate = 1;
+    float minCutoff = 1;
+    float beta = 0;
+    float derivCoeff = 1;
+    float value = 0;
+    float prevIn = 0;           ///< Previous input, for the rate of change
+    float deriv = 0;            ///< Smoothed rate of change of the input
+};
+
+/// @brief Moving average of integer values
+/// @details The length is a power of 2 so the average is calculated using a
+/// shift instead of a divide and the buffer index wraps around using a mask.
+/// Cost: 1 add, 1 subtract, 1 shift per update.
+/// @tparam T Integer value type
+/// @tparam LENGTH_BITS Log2 of the number of values to average
+template<typename T, unsigned LENGTH_BITS>
+class MovingAverage
+{
+public:
+    static_assert(std::is_integral_v<T>);
+    static constexpr size_t length = size_t(1) << LENGTH_BITS;
+
+    /// @brief Fill the buffer with a value
+    /// @param val
+    constexpr void Reset(T val)
+    {
+        for (auto&& v : buf) {
+            v = val;
+        }
+        sum = sum_t(val) << LENGTH_BITS;
+        pos = 0;
+    }
+
+    /// @brief Return the current average value
+    /// @return
+    constexpr T GetAverage() const { return T(sum >> LENGTH_BITS); }
+
+    /// @brief Add a value to the moving average, replacing the oldest value
+    /// @param in
+    /// @return The updated average value
+    constexpr T Process(T in)
+    {
+        sum += sum_t(in) - sum_t(buf[pos]);
+        buf[pos] = in;
+        pos = (pos + 1) & (length - 1);
+        return GetAverage();
+    }
+
+    /// @brief Add a block of values to the moving average
+    /// @param vals
+    /// @return The updated average value
+    constexpr T ProcessBlock(std::span<const T> vals)
+    {
+        for (auto&& val : vals) {
+            Process(val);
+        }
+        return GetAverage();
+    }
+
+private:
+    /// @brief Type for the sum, big enough to avoid overflow
+    using sum_t = std::conditional_t<(sizeof(T) + (LENGTH_BITS + 7) / 8 <= 4),
+        std::conditional_t<std::is_signed_v<T>, int32_t, uint32_t>,
+        std::conditional_t<std::is_signed_v<T>, int64_t, uint64_t>>;
+
+    T buf[length] = { };
+    sum_t sum = 0;
+    size_t pos = 0;
+};
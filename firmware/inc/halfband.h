@@ -0,0 +1,316 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <numbers>
+#include <span>
+
+// Half-band filters for changing the sample rate by a factor of 2
+//
+// A half-band low-pass FIR filter has its cutoff at a quarter of the (higher)
+// sample rate. Every other coefficient is zero apart from the centre one,
+// which is 1/2, so a filter with 4N-1 taps has only N distinct non-zero
+// coefficients (it is symmetrical). Splitting it into polyphase components
+// means the decimator and interpolator only calculate the samples that are
+// kept, and skip the multiplications by zero:
+// - Decimator: N multiplies per output sample (per 2 input samples)
+// - Interpolator: N multiplies per input sample (per 2 output samples)
+//
+// The coefficients are calculated at compile time using a Kaiser-windowed sinc.
+
+namespace HalfBand {
+
+/// @brief Modified Bessel function of the first kind, order 0
+/// @param x
+/// @return
+constexpr double BesselI0(double x)
+{
+    double sum = 1;
+    double term = 1;
+    for (unsigned k = 1; k < 32; ++k) {
+        double t = x / (2 * k);
+        term *= t * t;
+        sum += term;
+    }
+    return sum;
+}
+
+/// @brief Calculate the coefficients for a half-band filter
+/// @details Returns the coefficients for the taps at odd distances 1, 3, 5...
+/// from the centre tap, normalized for a DC gain of 1.
+/// @tparam NUM_COEFFS Number of distinct non-zero coefficients (not counting
+/// the centre tap)
+/// @param beta Kaiser window shape parameter: higher gives more stop-band
+/// attenuation but a wider transition band
+/// @return
+template<size_t NUM_COEFFS>
+constexpr std::array<float, NUM_COEFFS> DesignCoeffs(double beta)
+{
+    std::array<double, NUM_COEFFS> coeffs;
+    double sum = 0;
+    const double halfLength = 2 * NUM_COEFFS;
+    for (size_t k = 0; k < NUM_COEFFS; ++k) {
+        // Ideal half-band response at odd n is sin(pi n / 2) / (pi n)
+        double n = double(2 * k + 1);
+        double sinc = ((k % 2) ? -1 : 1) / (std::numbers::pi * n);
+        double r = n / halfLength;
+        double window = BesselI0(beta * std::sqrt(1 - r * r)) / BesselI0(beta);
+        coeffs[k] = sinc * window;
+        sum += coeffs[k];
+    }
+    // Centre tap (1/2) plus both sides must add up to 1
+    std::array<float, NUM_COEFFS> result;
+    for (size_t k = 0; k < NUM_COEFFS; ++k) {
+        result[k] = float(coeffs[k] * 0.25 / sum);
+    }
+    return result;
+}
+
+/// @brief Sample history for a polyphase filter
+/// @details Each sample is stored twice so the most recent LENGTH samples can
+/// always be read as one contiguous array, newest first, without wrapping.
+/// @tparam LENGTH
+template<size_t LENGTH>
+class History
+{
+public:
+    void Reset() { buf.fill(0); pos = 0; }
+
+    /// @brief Add a new sample
+    /// @param x
+    void Push(float x)
+    {
+        pos = (pos == 0) ? LENGTH - 1 : pos - 1;
+        buf[pos] = x;
+        buf[pos + LENGTH] = x;
+    }
+
+    /// @brief Return the i'th most recent sample (0 = newest)
+    /// @param i
+    /// @return
+    float operator[](size_t i) const { return buf[pos + i]; }
+
+private:
+    std::array<float, 2 * LENGTH> buf = { };
+    size_t pos = 0;
+};
+
+/// @brief Default number of distinct coefficients (47-tap filter)
+/// @details With @ref defaultBeta this gives pass-band ripple of 0.01dB up to
+/// 10kHz and stop-band attenuation of 60dB from 14kHz at 48kHz.
+static constexpr size_t defaultNumCoeffs = 12;
+
+/// @brief Default Kaiser window shape parameter
+static constexpr double defaultBeta = 6;
+
+/// @brief Number of distinct coefficients for the outer stage of 4x
+/// oversampling (15-tap filter)
+/// @details Between 2x and 4x the sample rate, the filter only has to pass the
+/// audio band and stop its images, so the transition band is much wider: this
+/// gives 60dB attenuation from 72kHz at 192kHz.
+static constexpr size_t outerNumCoeffs = 4;
+
+} // namespace HalfBand
+
+/// @brief Half-band decimator: halves the sample rate
+/// @tparam NUM_COEFFS Number of distinct coefficients (filter length is
+/// 4 * NUM_COEFFS - 1)
+template<size_t NUM_COEFFS = HalfBand::defaultNumCoeffs>
+class HalfBandDecimator
+{
+public:
+    static constexpr size_t numCoeffs = NUM_COEFFS;
+
+    /// @brief Filter delay, in samples at the input (higher) sample rate
+    static constexpr size_t delay = 2 * numCoeffs - 1;
+
+    void Reset()
+    {
+        evenHist.Reset();
+        oddHist.Reset();
+    }
+
+    /// @brief Decimate one pair of input samples to one output sample
+    /// @param in0 Earlier input sample
+    /// @param in1 Later input sample
+    /// @return
+    float Process(float in0, float in1)
+    {
+        oddHist.Push(in0);
+        evenHist.Push(in1);
+        float out = 0.5f * oddHist[numCoeffs - 1];
+        for (size_t k = 0; k < numCoeffs; ++k) {
+            out += coeffs[k] * (evenHist[numCoeffs - 1 - k] + evenHist[numCoeffs + k]);
+        }
+        return out;
+    }
+
+    /// @brief Decimate a block of samples
+    /// @param in Input samples (an even number of them)
+    /// @param out Output samples (half as many as the input)
+    void ProcessBlock(std::span<const float> in, std::span<float> out)
+    {
+        for (size_t i = 0; i < out.size(); ++i) {
+            out[i] = Process(in[2 * i], in[2 * i + 1]);
+        }
+    }
+
+private:
+    static constexpr auto coeffs = HalfBand::DesignCoeffs<numCoeffs>(HalfBand::defaultBeta);
+
+    HalfBand::History<2 * numCoeffs> evenHist;  ///< Inputs that go through the coefficients
+    HalfBand::History<numCoeffs> oddHist;       ///< Inputs that go through the centre tap
+};
+
+/// @brief Half-band interpolator: doubles the sample rate
+/// @tparam NUM_COEFFS Number of distinct coefficients (filter length is
+/// 4 * NUM_COEFFS - 1)
+template<size_t NUM_COEFFS = HalfBand::defaultNumCoeffs>
+class HalfBandInterpolator
+{
+public:
+    static constexpr size_t numCoeffs = NUM_COEFFS;
+
+    /// @brief Filter delay, in samples at the output (higher) sample rate
+    static constexpr size_t delay = 2 * numCoeffs - 1;
+
+    void Reset() { hist.Reset(); }
+
+    /// @brief Interpolate one input sample to a pair of output samples
+    /// @param in Input sample
+    /// @param out0 Earlier output sample
+    /// @param out1 Later output sample
+    void Process(float in, float& out0, float& out1)
+    {
+        hist.Push(in);
+        float sum = 0;
+        for (size_t k = 0; k < numCoeffs; ++k) {
+            sum += coeffs[k] * (hist[numCoeffs - 1 - k] + hist[numCoeffs + k]);
+        }
+        out0 = 2.f * sum;
+        out1 = hist[numCoeffs - 1];
+    }
+
+    /// @brief Interpolate a block of samples
+    /// @param in Input samples
+    /// @param out Output samples (twice as many as the input)
+    void ProcessBlock(std::span<const float> in, std::span<float> out)
+    {
+        for (size_t i = 0; i < in.size(); ++i) {
+            Process(in[i], out[2 * i], out[2 * i + 1]);
+        }
+    }
+
+private:
+    static constexpr auto coeffs = HalfBand::DesignCoeffs<numCoeffs>(HalfBand::defaultBeta);
+
+    HalfBand::History<2 * numCoeffs> hist;
+};
+
+/// @brief 2x or 4x oversampling using half-band filters
+/// @details Upsample() raises the sample rate to run some non-linear
+/// processing (which creates harmonics above the original Nyquist frequency)
+/// and Downsample() filters and lowers it again, so those harmonics are
+/// removed instead of aliasing down into the audio band.
+/// 4x oversampling cascades two stages each way. The inner stage (between 1x
+/// and 2x) uses the default filter and the outer stage (between 2x and 4x)
+/// uses a much shorter one, see @ref HalfBand::outerNumCoeffs.
+///
+/// Cost per sample at the base rate, in multiply-adds:
+/// - 2x: 2 * 12 = 24
+/// - 4x: 2 * 12 + 2 * 2 * 4 = 40
+///
+/// The factor is set at run time; a factor of 1 does no filtering.
+class HalfBandOversampler
+{
+public:
+    static constexpr unsigned maxFactor = 4;
+
+    /// @brief Set the oversampling factor
+    /// @details The filters are reset if it has changed.
+    /// @param factor 1, 2 or 4
+    void SetFactor(unsigned factor)
+    {
+        factor = (factor >= 4) ? 4 : (factor >= 2) ? 2 : 1;
+        if (factor != this->factor) {
+            this->factor = factor;
+            Reset();
+        }
+    }
+
+    /// @brief Return the oversampling factor
+    /// @return
+    unsigned GetFactor() const { return factor; }
+
+    void Reset()
+    {
+        innerUp.Reset();
+        innerDown.Reset();
+        outerUp.Reset();
+        outerDown.Reset();
+    }
+
+    /// @brief Return the delay of Upsample() and Downsample() together
+    /// @return Delay in samples at the base rate
+    float GetLatency() const
+    {
+        // Each stage's up and down filters together delay by their two filter
+        // delays at the higher rate, less one sample because the decimator
+        // output is aligned with the later of each pair of input samples
+        static constexpr float inner = float(InnerUp::delay + InnerDown::delay - 1) / 2;
+        static constexpr float outer = float(OuterUp::delay + OuterDown::delay - 1) / 4;
+        return (factor == 4) ? inner + outer : (factor == 2) ? inner : 0;
+    }
+
+    /// @brief Raise the sample rate
+    /// @param in Input samples
+    /// @param out Output samples (factor times as many as the input)
+    void Upsample(std::span<const float> in, std::span<float> out)
+    {
+        if (factor == 4) {
+            // Use the second half of the output as the intermediate buffer:
+            // each intermediate sample is read before it is overwritten
+            auto mid = out.subspan(out.size() / 2, in.size() * 2);
+            innerUp.ProcessBlock(in, mid);
+            outerUp.ProcessBlock(mid, out);
+        } else if (factor == 2) {
+            innerUp.ProcessBlock(in, out);
+        } else {
+            std::copy(in.begin(), in.end(), out.begin());
+        }
+    }
+
+    /// @brief Lower the sample rate
+    /// @param in Input samples
+    /// @param out Output samples (1 / factor as many as the input)
+    void Downsample(std::span<const float> in, std::span<float> out)
+    {
+        if (factor == 4) {
+            static constexpr size_t maxMid = 64;
+            float mid[maxMid];
+            for (size_t start = 0; start < out.size(); start += maxMid / 2) {
+                size_t size = std::min(out.size() - start, maxMid / 2);
+                outerDown.ProcessBlock(in.subspan(start * 4, size * 4), std::span(mid, size * 2));
+                innerDown.ProcessBlock(std::span(mid, size * 2), out.subspan(start, size));
+            }
+        } else if (factor == 2) {
+            innerDown.ProcessBlock(in, out);
+        } else {
+            std::copy(in.begin(), in.end(), out.begin());
+        }
+    }
+
+private:
+    using InnerUp = HalfBandInterpolator<>;
+    using InnerDown = HalfBandDecimator<>;
+    using OuterUp = HalfBandInterpolator<HalfBand::outerNumCoeffs>;
+    using OuterDown = HalfBandDecimator<HalfBand::outerNumCoeffs>;
+
+    InnerUp innerUp;
+    InnerDown innerDown;
+    OuterUp outerUp;
+    OuterDown outerDown;
+    unsigned factor = 1;
+};
@@ -1,53 +1,354 @@
 #pragma once
 
+#include <cstdint>
+#include <span>
+#include <type_traits>
+
 #include "datatable.h"
 
-/// @brief Table lookup and interpolation
-/// @details Multiple LookupTable classes can be defined, each using a different
-/// lookup table. The lookup table is defined by a static DataTable object.
-/// The size of the table and the size of the input value range are powers of 2.
-/// @tparam VALUE_T Type of values in the wavetable
+/// @brief Interpolation modes for @ref LookupTable
+/// @details Each mode is a policy class with a function that calculates the
+/// output value from the two nearest table entries and the fractional part of
+/// the input value (the low SHIFT bits), and the minimum SHIFT it works with.
+namespace Interp
+{
+    /// @brief Original interpolation, kept for comparison
+    /// @details Three conditional halving steps, i.e. 3-bit interpolation.
+    struct Legacy
+    {
+        static constexpr unsigned minShift = 3;
+
+        template<typename VALUE_T, unsigned SHIFT>
+        static constexpr VALUE_T Interpolate(VALUE_T entry0, VALUE_T entry1, unsigned frac)
+        {
+            static_assert(SHIFT >= minShift); // else this code is wrong
+            VALUE_T value = entry0;
+            value = VALUE_T((value + ((frac & (0x1 << (SHIFT - 3))) ? entry1 : entry0)) / 2);
+            value = VALUE_T((value + ((frac & (0x1 << (SHIFT - 2))) ? entry1 : entry0)) / 2);
+            value = VALUE_T((value + ((frac & (0x1 << (SHIFT - 1))) ? entry1 : entry0)) / 2);
+            return value;
+        }
+    };
+
+    /// @brief No interpolation - return the nearest table entry
+    struct Nearest
+    {
+        static constexpr unsigned minShift = 0;
+
+        template<typename VALUE_T, unsigned SHIFT>
+        static constexpr VALUE_T Interpolate(VALUE_T entry0, VALUE_T entry1, unsigned frac)
+        {
+            if constexpr (SHIFT == 0) {
+                return entry0;
+            } else {
+                return (frac >> (SHIFT - 1)) ? entry1 : entry0;
+            }
+        }
+    };
+
+    /// @brief Linear interpolation in floating point
+    /// @details The compiler turns this into one multiply and one multiply-add
+    /// (the scale factor is a constant).
+    struct Linear
+    {
+        static constexpr unsigned minShift = 0;
+
+        template<typename VALUE_T, unsigned SHIFT>
+        static constexpr VALUE_T Interpolate(VALUE_T entry0, VALUE_T entry1, unsigned frac)
+        {
+            static_assert(std::is_floating_point_v<VALUE_T>);
+            constexpr VALUE_T scale = VALUE_T(1) / VALUE_T(1u << SHIFT);
+            return entry0 + VALUE_T(frac) * scale * (entry1 - entry0);
+        }
+    };
+
+    /// @brief Exact linear interpolation in integer arithmetic
+    /// @details The fraction is converted to Q16 fixed point, so the table
+    /// values can be e.g. Q16 fixed-point numbers. The result is rounded
+    /// towards minus infinity.
+    struct LinearQ16
+    {
+        static constexpr unsigned minShift = 0;
+
+        template<typename VALUE_T, unsigned SHIFT>
+        static constexpr VALUE_T Interpolate(VALUE_T entry0, VALUE_T entry1, unsigned frac)
+        {
+            static_assert(std::is_integral_v<VALUE_T> && sizeof(VALUE_T) <= 4);
+            static_assert(SHIFT <= 16);
+            int64_t frac16 = int64_t(frac) << (16 - SHIFT);
+            return VALUE_T(entry0 + (((int64_t(entry1) - int64_t(entry0)) * frac16) >> 16));
+        }
+    };
+}
+
+/// @brief Table lookup and interpolation - common implementation
+/// @details The size of the table and the size of the input value range are
+/// powers of 2. The table has one extra entry at the end to help with
+/// interpolation.
+/// @tparam VALUE_T Type of values in the table
 /// @tparam BITS_IN Number of bits for unsigned input values
 /// @tparam BITS_TABLE Number of bits for the table size
-/// @tparam FUNC_CALC_1 Function/lambda to calculate one table entry
-template<typename VALUE_T, unsigned BITS_IN, unsigned BITS_TABLE,
-         VALUE_T FUNC_CALC_1(size_t index, size_t numValues)>
-class LookupTable
+/// @tparam INTERP Interpolation mode - one of the @ref Interp classes
+template<typename VALUE_T, unsigned BITS_IN, unsigned BITS_TABLE, typename INTERP>
+class LookupTableBase
 {
 public:
     using value_t = VALUE_T;
+    using interp_t = INTERP;
     static constexpr unsigned nBitsIn = BITS_IN;
     static constexpr unsigned nBitsTable = BITS_TABLE;
     static_assert(nBitsIn >= nBitsTable);
-    static_assert(nBitsIn - nBitsTable >= 3); // else the interpolation code is wrong
     static constexpr unsigned nBitsShift = nBitsIn - nBitsTable;
+    static_assert(nBitsShift >= INTERP::minShift);
     static constexpr size_t tableSize = (1 << nBitsTable);
 
+protected:
     /// @brief Return the interpolated output value for the given input value
-    /// @param n 
-    /// @return 
-    static VALUE_T lookupInterpolate(unsigned n)
+    /// @param table Table of (tableSize + 1) values
+    /// @param n
+    /// @return
+    static VALUE_T interpolate(const VALUE_T* table, unsigned n)
     {
         // Find the nearest pair of values in the lookup table
         unsigned index = (n >> nBitsShift) % tableSize;
-        VALUE_T entry0 = lookupTable[index];
-        VALUE_T entry1 = lookupTable[index+1];
-        // Interpolate between the two table values using the next 3 bits of n
-        VALUE_T value = entry0;
-        value = VALUE_T((value +
-            ((n & (0x1 << (nBitsShift - 3))) ? entry1 : entry0)) / 2);
-        value = VALUE_T((value +
-            ((n & (0x1 << (nBitsShift - 2))) ? entry1 : entry0)) / 2);
-        value = VALUE_T((value +
-            ((n & (0x1 << (nBitsShift - 1))) ? entry1 : entry0)) / 2);
-        return value;
+        unsigned frac = n & ((1u << nBitsShift) - 1);
+        return INTERP::template Interpolate<VALUE_T, nBitsShift>(
+            table[index], table[index+1], frac);
+    }
+
+    /// @brief Return the interpolated output values for a block of input values
+    /// @details The loop body has no branches (for the Linear and LinearQ16
+    /// modes) and is unrolled by the compiler, so the table loads of one value
+    /// can overlap with the arithmetic for another.
+    /// @param table Table of (tableSize + 1) values
+    /// @param in Input values
+    /// @param out Output values - must be at least as long as in
+    static void interpolateBlock(const VALUE_T* table,
+                                 std::span<const uint16_t> in, std::span<VALUE_T> out)
+    {
+        static_assert(nBitsIn <= 16);
+        VALUE_T* pOut = out.data();
+        #pragma GCC unroll 4
+        for (uint16_t n : in) {
+            *pOut++ = interpolate(table, n);
+        }
+    }
+};
+
+/// @brief Table lookup and interpolation
+/// @details Multiple LookupTable classes can be defined, each using a different
+/// lookup table. The lookup table is defined by a static DataTable object.
+/// The size of the table and the size of the input value range are powers of 2.
+/// @tparam VALUE_T Type of values in the wavetable
+/// @tparam BITS_IN Number of bits for unsigned input values
+/// @tparam BITS_TABLE Number of bits for the table size
+/// @tparam FUNC_CALC_1 Function/lambda to calculate one table entry
+/// @tparam INTERP Interpolation mode - one of the @ref Interp classes
+template<typename VALUE_T, unsigned BITS_IN, unsigned BITS_TABLE,
+         VALUE_T FUNC_CALC_1(size_t index, size_t numValues),
+         typename INTERP = Interp::Linear>
+class LookupTable : public LookupTableBase<VALUE_T, BITS_IN, BITS_TABLE, INTERP>
+{
+    using base_t = LookupTableBase<VALUE_T, BITS_IN, BITS_TABLE, INTERP>;
+
+public:
+    /// @brief Return the interpolated output value for the given input value
+    /// @param n
+    /// @return
+    static VALUE_T lookupInterpolate(unsigned n)
+    {
+        return base_t::interpolate(lookupTable.begin(), n);
+    }
+
+    /// @brief Return the interpolated output values for a block of input values
+    /// @param in Input values
+    /// @param out Output values - must be at least as long as in
+    static void lookupBlock(std::span<const uint16_t> in, std::span<VALUE_T> out)
+    {
+        base_t::interpolateBlock(lookupTable.begin(), in, out);
     }
 
+    /// @brief Return the table values, e.g. for testing other interpolation modes
+    /// @return Pointer to (tableSize + 1) values
+    static constexpr const VALUE_T* data() { return lookupTable.begin(); }
+
 private:
     /// @brief @ref DataTable type containing calculated values
     /// @details The DataTable has one extra entry to help with interpolation.
-    using table_t = DataTable<VALUE_T, tableSize+1, FUNC_CALC_1>;
+    using table_t = DataTable<VALUE_T, base_t::tableSize+1, FUNC_CALC_1>;
 
     /// @brief Table containing calculated values
     static constexpr table_t lookupTable = table_t();
 };
+
+/// @brief Table lookup and interpolation, with the table calculated at runtime
+/// @details This works like @ref LookupTable except that the table values are
+/// calculated by Init() rather than at compile time, e.g. because they depend
+/// on calibration settings. The table is stored in the object so it can be
+/// placed in any memory region (e.g. DSY_SDRAM_BSS for big tables).
+/// Lookups cost the same as for @ref LookupTable.
+/// @tparam VALUE_T Type of values in the table
+/// @tparam BITS_IN Number of bits for unsigned input values
+/// @tparam BITS_TABLE Number of bits for the table size
+/// @tparam INTERP Interpolation mode - one of the @ref Interp classes
+template<typename VALUE_T, unsigned BITS_IN, unsigned BITS_TABLE,
+         typename INTERP = Interp::Linear>
+class RuntimeLookupTable : public LookupTableBase<VALUE_T, BITS_IN, BITS_TABLE, INTERP>
+{
+    using base_t = LookupTableBase<VALUE_T, BITS_IN, BITS_TABLE, INTERP>;
+
+public:
+    /// @brief Calculate the table values
+    /// @param funcCalc1 Function/lambda to calculate one table entry, with the
+    /// signature: VALUE_T funcCalc1(size_t index, size_t numValues)
+    void Init(auto funcCalc1)
+    {
+        for (size_t index = 0; index < numValues; ++index) {
+            lookupTable[index] = funcCalc1(index, numValues);
+        }
+    }
+
+    /// @brief Return the interpolated output value for the given input value
+    /// @param n
+    /// @return
+    VALUE_T lookupInterpolate(unsigned n) const
+    {
+        return base_t::interpolate(lookupTable, n);
+    }
+
+    /// @brief Return the interpolated output values for a block of input values
+    /// @param in Input values
+    /// @param out Output values - must be at least as long as in
+    void lookupBlock(std::span<const uint16_t> in, std::span<VALUE_T> out) const
+    {
+        base_t::interpolateBlock(lookupTable, in, out);
+    }
+
+    /// @brief Return the table values, e.g. for testing other interpolation modes
+    /// @return Pointer to (tableSize + 1) values
+    const VALUE_T* data() const { return lookupTable; }
+
+private:
+    /// @brief Number of table entries, including one extra to help with interpolation
+    static constexpr size_t numValues = base_t::tableSize + 1;
+
+    /// @brief Table containing calculated values
+    VALUE_T lookupTable[numValues];
+};
+
+/// @brief Error measures for @ref LookupTableSizer
+namespace LookupError
+{
+    /// @brief Absolute error
+    constexpr double Absolute(double value, double exact)
+    {
+        return (value > exact) ? value - exact : exact - value;
+    }
+
+    /// @brief Relative error - the exact value must not be 0
+    constexpr double Relative(double value, double exact)
+    {
+        return Absolute(value, exact) / Absolute(exact, 0);
+    }
+}
+
+/// @brief Choose the size of a lookup table at compile time to meet an error target
+/// @details The function is evaluated at a quarter, half and three quarters
+/// of the way between each pair of table entries and compared to the
+/// interpolated value, to find the maximum error for each table size.
+/// @tparam VALUE_T Type of values in the table
+/// @tparam BITS_IN Number of bits for unsigned input values
+/// @tparam FUNC_IN Function to calculate the output value for an input value
+/// in [0, 2^BITS_IN] (the last value is for the extra table entry)
+/// @tparam INTERP Interpolation mode - one of the @ref Interp classes
+/// @tparam FUNC_ERR Error measure - e.g. one of the @ref LookupError functions
+template<typename VALUE_T, unsigned BITS_IN, VALUE_T FUNC_IN(unsigned n),
+         typename INTERP = Interp::Linear,
+         double FUNC_ERR(double value, double exact) = LookupError::Absolute>
+class LookupTableSizer
+{
+public:
+    /// @brief Largest table size that the interpolation mode can handle
+    static constexpr unsigned maxBitsTable = BITS_IN - INTERP::minShift;
+
+    /// @brief Calculate one table entry (a FUNC_CALC_1 for @ref LookupTable)
+    /// @tparam BITS_TABLE Number of bits for the table size
+    /// @param index
+    /// @param numValues
+    /// @return
+    template<unsigned BITS_TABLE>
+    static constexpr VALUE_T CalcEntry(size_t index, size_t numValues)
+    {
+        return FUNC_IN(unsigned(index << (BITS_IN - BITS_TABLE)));
+    }
+
+    /// @brief Return the max error of a table of the given size
+    /// @tparam BITS_TABLE Number of bits for the table size
+    /// @return
+    template<unsigned BITS_TABLE>
+    static constexpr double MaxError()
+    {
+        constexpr unsigned shift = BITS_IN - BITS_TABLE;
+        constexpr unsigned segment = 1u << shift;
+        constexpr unsigned step = (shift >= 2) ? segment / 4 : 1;
+        double maxErr = 0;
+        for (unsigned index = 0; index < (1u << BITS_TABLE); ++index) {
+            unsigned n0 = index << shift;
+            VALUE_T entry0 = FUNC_IN(n0);
+            VALUE_T entry1 = FUNC_IN(n0 + segment);
+            for (unsigned frac = step; frac < segment; frac += step) {
+                VALUE_T value = INTERP::template Interpolate<VALUE_T, shift>(entry0, entry1, frac);
+                double err = FUNC_ERR(double(value), double(FUNC_IN(n0 + frac)));
+                maxErr = (err > maxErr) ? err : maxErr;
+            }
+        }
+        return maxErr;
+    }
+
+    /// @brief Return the number of bits for the smallest table that meets the
+    /// error target, or @ref maxBitsTable if none of them do
+    /// @tparam MAX_ERR Error target
+    /// @tparam BITS_TABLE Smallest table size to consider
+    /// @return
+    template<double MAX_ERR, unsigned BITS_TABLE = 1>
+    static constexpr unsigned BitsForMaxError()
+    {
+        if constexpr (BITS_TABLE >= maxBitsTable) {
+            return maxBitsTable;
+        } else {
+            if (MaxError<BITS_TABLE>() <= MAX_ERR) {
+                return BITS_TABLE;
+            }
+            return BitsForMaxError<MAX_ERR, BITS_TABLE + 1>();
+        }
+    }
+};
+
+/// @brief Table lookup and interpolation, with the smallest table that meets
+/// an error target
+/// @details This is a @ref LookupTable with its size chosen by
+/// @ref LookupTableSizer at compile time. Compilation fails if the error
+/// target can't be met.
+/// @tparam VALUE_T Type of values in the table
+/// @tparam BITS_IN Number of bits for unsigned input values
+/// @tparam FUNC_IN Function to calculate the output value for an input value
+/// @tparam MAX_ERR Error target
+/// @tparam INTERP Interpolation mode - one of the @ref Interp classes
+/// @tparam FUNC_ERR Error measure - e.g. one of the @ref LookupError functions
+template<typename VALUE_T, unsigned BITS_IN, VALUE_T FUNC_IN(unsigned n), double MAX_ERR,
+         typename INTERP = Interp::Linear,
+         double FUNC_ERR(double value, double exact) = LookupError::Absolute>
+class SizedLookupTable : public LookupTable<VALUE_T, BITS_IN,
+    LookupTableSizer<VALUE_T, BITS_IN, FUNC_IN, INTERP, FUNC_ERR>::template BitsForMaxError<MAX_ERR>(),
+    LookupTableSizer<VALUE_T, BITS_IN, FUNC_IN, INTERP, FUNC_ERR>::template CalcEntry<
+        LookupTableSizer<VALUE_T, BITS_IN, FUNC_IN, INTERP, FUNC_ERR>::template BitsForMaxError<MAX_ERR>()>,
+    INTERP>
+{
+    using sizer_t = LookupTableSizer<VALUE_T, BITS_IN, FUNC_IN, INTERP, FUNC_ERR>;
+
+public:
+    /// @brief The max error of the table (no more than MAX_ERR)
+    static constexpr double maxError =
+        sizer_t::template MaxError<sizer_t::template BitsForMaxError<MAX_ERR>()>();
+    static_assert(maxError <= MAX_ERR, "lookup table error target can't be met");
+};
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+/// @brief Delay buffer for a multi-tap delay
+/// @details One circular buffer is written once per sample and can be read
+/// by any number of taps, each with its own delay time.
+/// Samples are processed in blocks: the taps are read for a whole block (one
+/// tap at a time, so each one walks through memory in order) and then the
+/// block is written. Because of this, the minimum delay time is one block.
+/// The buffer size is a power of 2 so the read/write positions wrap around
+/// using a mask instead of a divide.
+/// The buffer is stored in the object, so big buffers can be placed in SDRAM
+/// using DSY_SDRAM_BSS.
+/// Reading and writing slow memory such as SDRAM is faster in bursts than one
+/// sample at a time, so a block's worth of samples can be staged through a
+/// small buffer in fast memory (e.g. DTCM): each tap read copies the whole
+/// window of samples it needs with one copy (two if it wraps around), and
+/// writes go straight from the caller's block with one copy.
+/// @tparam T Sample type
+/// @tparam MAX_DELAY Maximum delay time in samples
+template<typename T, size_t MAX_DELAY>
+class MultiTapDelay
+{
+public:
+    /// @brief Maximum delay time in samples
+    static constexpr size_t maxDelay = MAX_DELAY;
+
+    /// @brief Buffer size, with room for the extra sample needed to
+    /// interpolate at the maximum delay time
+    static constexpr size_t bufferSize = std::bit_ceil(maxDelay + 2);
+
+    /// @brief Clear the buffer
+    void Init()
+    {
+        std::fill(std::begin(buffer), std::end(buffer), T(0));
+        writePos = 0;
+    }
+
+    /// @brief Read a block of samples for one tap
+    /// @details The delay time ramps linearly from delayFrom (not included)
+    /// to delayTo (the delay time for the last sample) - make them equal for
+    /// a fixed delay time. Fractional delay times are linearly interpolated.
+    /// The delay times are limited to [out.size(), maxDelay].
+    /// If staging is big enough for the window of samples the block needs
+    /// (out.size() plus the change in delay time plus 3), the window is copied
+    /// there first and the samples are interpolated from that; otherwise they
+    /// are read straight from the delay buffer.
+    /// @param out Output samples - no more than the next block's size
+    /// @param delayFrom Delay time in samples before the block
+    /// @param delayTo Delay time in samples for the last sample of the block
+    /// @param staging Optional staging buffer in fast memory
+    void ReadBlock(std::span<T> out, float delayFrom, float delayTo,
+                   std::span<T> staging = { }) const
+    {
+        const float minDelay = float(out.size());
+        delayFrom = std::clamp(delayFrom, minDelay, float(maxDelay));
+        delayTo = std::clamp(delayTo, minDelay, float(maxDelay));
+
+        // Window of buffer positions read by this block: the oldest sample is
+        // the one after the longest delay time for the first output sample,
+        // the newest is the shortest delay time for the last output sample.
+        // Allow one extra sample at each end for rounding errors in the ramp.
+        const uint32_t delayMax = uint32_t(std::max(delayFrom, delayTo)) + 1;
+        const uint32_t delayMin = uint32_t(std::min(delayFrom, delayTo)) - 1;
+        const size_t windowSize = out.size() + delayMax - delayMin + 1;
+        if (windowSize <= staging.size()) {
+            const size_t start = (writePos - delayMax - 1) & mask;
+            CopyOut(start, staging.first(windowSize));
+            ReadRamp(out, delayFrom, delayTo, staging.data(),
+                     delayMax + 1, ~size_t(0));
+        } else {
+            ReadRamp(out, delayFrom, delayTo, buffer, writePos, mask);
+        }
+    }
+
+    /// @brief Write a block of samples
+    /// @details This must be called after the taps have been read for the block.
+    /// @param in Input samples
+    void WriteBlock(std::span<const T> in)
+    {
+        const size_t first = std::min(in.size(), bufferSize - writePos);
+        std::copy(in.begin(), in.begin() + first, buffer + writePos);
+        std::copy(in.begin() + first, in.end(), buffer);
+        writePos = (writePos + in.size()) & mask;
+    }
+
+private:
+    static constexpr size_t mask = bufferSize - 1;
+
+    /// @brief Interpolate a block of samples with a ramped delay time
+    /// @param out Output samples
+    /// @param delayFrom Delay time in samples before the block
+    /// @param delayTo Delay time in samples for the last sample of the block
+    /// @param src Samples to read from: the delay buffer or a staged window
+    /// @param pos Position in src of the next sample to be written
+    /// @param posMask Mask to wrap the read positions around src: the buffer
+    /// size - 1 for the delay buffer, or all ones for a staged window (which
+    /// doesn't wrap)
+    static void ReadRamp(std::span<T> out, float delayFrom, float delayTo,
+                         const T* src, size_t pos, size_t posMask)
+    {
+        const float delayStep = (delayTo - delayFrom) / float(out.size());
+        float delay = delayFrom;
+        for (auto&& sample : out) {
+            delay += delayStep;
+            uint32_t delayInt = uint32_t(delay);
+            float delayFrac = delay - float(delayInt);
+            T a = src[(pos - delayInt) & posMask];
+            T b = src[(pos - delayInt - 1) & posMask];
+            sample = a + (b - a) * delayFrac;
+            ++pos;
+        }
+    }
+
+    /// @brief Copy a run of samples out of the delay buffer
+    /// @param start Buffer position of the first sample
+    /// @param dest
+    void CopyOut(size_t start, std::span<T> dest) const
+    {
+        const size_t first = std::min(dest.size(), bufferSize - start);
+        std::copy(buffer + start, buffer + start + first, dest.begin());
+        std::copy(buffer, buffer + (dest.size() - first), dest.begin() + first);
+    }
+
+    T buffer[bufferSize];
+    size_t writePos = 0; ///< Position of the next sample to be written
+};
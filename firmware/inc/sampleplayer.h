@@ -0,0 +1,142 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+/// @brief A one-shot sample: mono 16-bit values, read in place wherever they
+/// are, e.g. in memory-mapped QSPI flash
+struct OneShotSample
+{
+    const int16_t* data = nullptr;  ///< Sample values
+    uint32_t length = 0;            ///< Number of sample values
+    float sampleRate = 48000;       ///< Sample rate the sample was recorded at
+};
+
+/// @brief Polyphonic player for @ref OneShotSample
+/// @details Each voice plays a sample once from start to end, reading it
+/// through its own pointer with linear interpolation, so it can be played at
+/// any pitch. The voices' state is kept in parallel arrays, and each active
+/// voice is processed for a whole block at a time with its state in local
+/// variables. The read position is fixed point (32.32 bits) so it is exact
+/// however long the sample is.
+///
+/// If a sample is triggered when all the voices are busy, the voice that was
+/// triggered longest ago is taken for it, which cuts off that sound.
+/// @tparam MAX_VOICES Number of voices
+template<size_t MAX_VOICES>
+class SamplePlayer
+{
+public:
+    static constexpr size_t maxVoices = MAX_VOICES;
+
+    /// @brief Initialize the player, with all the voices silent
+    /// @param sampleRate Output sample rate
+    void Init(float sampleRate)
+    {
+        this->sampleRate = sampleRate;
+        std::fill(std::begin(active), std::end(active), false);
+        triggerCount = 0;
+    }
+
+    /// @brief Start playing a sample
+    /// @param sample
+    /// @param pitch Playback speed: 1 for the original pitch, 2 for an octave
+    /// up, etc.
+    /// @param gain Output gain
+    void Trig(const OneShotSample& sample, float pitch, float gain)
+    {
+        if (!sample.data || sample.length < 2) {
+            return;
+        }
+        const size_t v = AllocVoice();
+        data[v] = sample.data;
+        // Stop before the last value, so there's always a next one to
+        // interpolate with
+        end[v] = uint64_t(sample.length - 1) << 32;
+        pos[v] = 0;
+        inc[v] = uint64_t(double(pitch) * sample.sampleRate / sampleRate * 4294967296.0);
+        this->gain[v] = gain / 32768.f;
+        started[v] = triggerCount++;
+        active[v] = true;
+    }
+
+    /// @brief Stop all the voices
+    void Stop() { std::fill(std::begin(active), std::end(active), false); }
+
+    /// @brief Return the number of voices playing
+    /// @return
+    size_t GetActiveVoices() const { return size_t(std::count(std::begin(active), std::end(active), true)); }
+
+    /// @brief Process a block of samples, adding the output of all the voices
+    /// @param out Output, which is overwritten
+    void ProcessBlock(std::span<float> out)
+    {
+        std::fill(out.begin(), out.end(), 0.f);
+        for (size_t v = 0; v < maxVoices; ++v) {
+            if (active[v]) {
+                active[v] = ProcessVoice(v, out);
+            }
+        }
+    }
+
+protected:
+    /// @brief Choose a voice for a new sample: a free one, or if there isn't
+    /// one, the one that was triggered longest ago
+    /// @return
+    size_t AllocVoice() const
+    {
+        size_t oldest = 0;
+        for (size_t v = 0; v < maxVoices; ++v) {
+            if (!active[v]) {
+                return v;
+            }
+            if (triggerCount - started[v] > triggerCount - started[oldest]) {
+                oldest = v;
+            }
+        }
+        return oldest;
+    }
+
+    /// @brief Add a voice's output for a block
+    /// @param v Voice number
+    /// @param out
+    /// @return true if the voice is still playing, false if it has finished
+    bool ProcessVoice(size_t v, std::span<float> out)
+    {
+        // Work on local copies of the voice state, so the compiler knows the
+        // output stores can't change it
+        const int16_t* const data = this->data[v];
+        const uint64_t end = this->end[v];
+        const uint64_t inc = this->inc[v];
+        const float gain = this->gain[v];
+        uint64_t pos = this->pos[v];
+        static constexpr float fracScale = 1.f / 4294967296.f;
+        for (float& x : out) {
+            if (pos >= end) {
+                return false;
+            }
+            const uint32_t index = uint32_t(pos >> 32);
+            const float frac = float(uint32_t(pos)) * fracScale;
+            const float s0 = data[index];
+            const float s1 = data[index + 1];
+            x += (s0 + frac * (s1 - s0)) * gain;
+            pos += inc;
+        }
+        this->pos[v] = pos;
+        return true;
+    }
+
+    float sampleRate = 48000;
+    uint32_t triggerCount = 0;      ///< Number of samples triggered so far
+
+    // Voice state
+    const int16_t* data[maxVoices] = { };   ///< Sample values
+    uint64_t end[maxVoices] = { };          ///< Read position where the sample ends
+    uint64_t pos[maxVoices] = { };          ///< Read position (32.32 bits fixed point)
+    uint64_t inc[maxVoices] = { };          ///< Read position increment per output sample
+    float gain[maxVoices] = { };            ///< Gain, including conversion from 16 bits
+    uint32_t started[maxVoices] = { };      ///< triggerCount when the voice was triggered
+    bool active[maxVoices] = { };           ///< Is the voice playing?
+};
@@ -46,6 +46,13 @@ constexpr bool isDifferent(unsigned v1, unsigned v2, unsigned minDiff)
     return diff > minDiff;
 }
 
+/// @brief Tiny value to add to a feedback path to stop it decaying into
+/// denormal numbers
+/// @details This is far below audibility but far above the largest denormal
+/// (about 1e-38). Adding it is cheap insurance for code built without
+/// flush-to-zero, e.g. on a host computer.
+static constexpr float antiDenormal = 1e-20f;
+
 /// @brief Split a floating-point number into whole-integer and fraction parts
 /// @details The integer part is signed. The fraction is unsigned, implicitly
 /// the same sign as the integer part. (This makes printing simpler.)
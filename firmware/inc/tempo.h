@@ -0,0 +1,215 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numbers>
+
+/// @brief Tempo tracker for an external clock: a software phase-locked loop
+/// that follows the edges of a clock signal and estimates its period
+/// @details Time is measured in samples (or any other unit) by calling
+/// Advance() regularly, e.g. once per audio block. Clock edges are given by
+/// calling Edge(), so they are timed to within one Advance() step.
+///
+/// Once locked, the tracker is a second-order delay-locked loop: it predicts
+/// the time of the next edge and adjusts its phase and period by a fraction of
+/// the difference between the predicted and actual edge times. This averages
+/// out edge jitter rather than following every edge.
+/// Edges too far from the prediction are rejected as outliers. Several edges
+/// in a row that aren't one period after the previous edge means the tempo
+/// has changed, so the tracker re-acquires, keeping the old period estimate
+/// until it locks to the new one. (A glitch or a missed edge only upsets one
+/// or two intervals, and any change of tempo bigger than the tolerance upsets
+/// all of them, even to a multiple of the old tempo.)
+/// Missing edges are filled in by the prediction; too many in a row means the
+/// clock has stopped, so the tracker unlocks.
+///
+/// Acquiring needs three edges with two similar intervals between them.
+/// Every function does a fixed amount of work, with no loops.
+///
+/// Acknowledgements
+/// ----------------
+/// Fons Adriaensen - "Using a DLL to filter time" (Linux Audio Conference 2005)
+class TempoTracker
+{
+public:
+    /// @brief Initialize the tracker
+    /// @param minPeriod Shortest clock period accepted
+    /// @param maxPeriod Longest clock period accepted
+    /// @param bandwidth Loop bandwidth as a fraction of the clock rate (lower
+    /// means more smoothing but slower to follow tempo changes)
+    void Init(float minPeriod, float maxPeriod, float bandwidth = 0.05f)
+    {
+        this->minPeriod = minPeriod;
+        this->maxPeriod = maxPeriod;
+        float omega = 2.f * std::numbers::pi_v<float> * bandwidth;
+        coeffPhase = std::numbers::sqrt2_v<float> * omega;
+        coeffPeriod = omega * omega;
+        Reset();
+    }
+
+    /// @brief Forget the clock and start acquiring again
+    void Reset()
+    {
+        state = State::Idle;
+        relocking = false;
+        sinceEdge = 0;
+        offTempo = 0;
+    }
+
+    /// @brief Return true if the tracker is locked to the clock
+    /// @return
+    bool IsLocked() const { return state == State::Locked; }
+
+    /// @brief Return true if there is a clock period to follow: the tracker is
+    /// locked, or re-acquiring after a tempo change
+    /// @return
+    bool HasPeriod() const { return state == State::Locked || relocking; }
+
+    /// @brief Return the estimated clock period (only valid if HasPeriod()
+    /// returns true). While re-acquiring this is the period before the change.
+    /// @return
+    float GetPeriod() const { return period; }
+
+    /// @brief Advance the time
+    /// @param time Time since the last call
+    void Advance(float time)
+    {
+        sinceEdge += time;
+        sincePredicted += time;
+        switch (state) {
+        case State::Idle:
+            break;
+        case State::Acquiring:
+            // Give up waiting for the next edge
+            if (sinceEdge > maxPeriod) {
+                Reset();
+            }
+            break;
+        case State::Locked:
+            // If the predicted edge is well past, assume it was missed and
+            // move on to the next prediction
+            if (sincePredicted - nextInterval > period * 0.5f) {
+                sincePredicted -= nextInterval;
+                nextInterval = period;
+                if (++missed > maxMissed) {
+                    if (offTempo > 0) {
+                        // Edges are still arriving, just not when predicted,
+                        // so the tempo has slowed down
+                        Relock(0);
+                    } else {
+                        Reset();
+                    }
+                }
+            }
+            break;
+        }
+    }
+
+    /// @brief Handle a clock edge at the current time
+    void Edge()
+    {
+        float interval = sinceEdge;
+        sinceEdge = 0;
+        switch (state) {
+        case State::Idle:
+            state = State::Acquiring;
+            candidate = 0;
+            break;
+        case State::Acquiring:
+            Acquire(interval);
+            break;
+        case State::Locked:
+            Track(interval);
+            break;
+        }
+    }
+
+protected:
+    /// @brief Handle an edge while acquiring
+    /// @param interval Time since the previous edge
+    void Acquire(float interval)
+    {
+        if (interval < minPeriod || interval > maxPeriod) {
+            candidate = 0;
+        } else if (IsClose(interval, candidate)) {
+            // Two similar intervals in a row - lock to their average
+            period = nextInterval = 0.5f * (interval + candidate);
+            sincePredicted = 0;
+            missed = 0;
+            offTempo = 0;
+            relocking = false;
+            state = State::Locked;
+        } else {
+            candidate = interval;
+        }
+    }
+
+    /// @brief Handle an edge while locked
+    /// @param interval Time since the previous edge
+    void Track(float interval)
+    {
+        // Too many intervals in a row that don't match the period means the
+        // tempo has changed, so start acquiring again from this edge
+        if (IsClose(interval, period)) {
+            offTempo = 0;
+        } else if (++offTempo > maxOffTempo) {
+            Relock(interval);
+            return;
+        }
+        float err = sincePredicted - nextInterval;
+        if (!IsClose(sincePredicted, nextInterval)) {
+            // Outlier: ignore it
+            return;
+        }
+        missed = 0;
+        sincePredicted = err;
+        nextInterval = period + coeffPhase * err;
+        period = std::clamp(period + coeffPeriod * err, minPeriod, maxPeriod);
+    }
+
+    /// @brief Start acquiring again after a tempo change, keeping the period
+    /// @param interval Time since the previous edge, or 0 if unknown
+    void Relock(float interval)
+    {
+        state = State::Acquiring;
+        relocking = true;
+        candidate = interval;
+    }
+
+    /// @brief Return true if a time is close enough to the expected time
+    /// @param time
+    /// @param expected
+    /// @return
+    bool IsClose(float time, float expected) const
+    {
+        return std::abs(time - expected) <= tolerance * expected;
+    }
+
+    /// @brief Largest difference from the expected interval for an edge to
+    /// count, as a fraction of the period
+    static constexpr float tolerance = 0.2f;
+
+    /// @brief Number of edges in a row not one period apart that means the
+    /// tempo has changed
+    static constexpr unsigned maxOffTempo = 2;
+
+    /// @brief Number of missed edges in a row that means the clock has stopped
+    static constexpr unsigned maxMissed = 3;
+
+    enum class State : uint8_t { Idle, Acquiring, Locked };
+
+    State state = State::Idle;
+    float minPeriod = 1;
+    float maxPeriod = 1;
+    float coeffPhase = 0;       ///< Phase correction per unit of edge time error
+    float coeffPeriod = 0;      ///< Period correction per unit of edge time error
+    float period = 1;           ///< Estimated clock period
+    float nextInterval = 1;     ///< Time from the last predicted edge to the next one
+    float sinceEdge = 0;        ///< Time since the last actual edge
+    float sincePredicted = 0;   ///< Time since the last predicted edge
+    float candidate = 0;        ///< Previous interval while acquiring
+    unsigned offTempo = 0;      ///< Number of edges in a row not one period apart
+    unsigned missed = 0;        ///< Number of missed edges in a row
+    bool relocking = false;     ///< Re-acquiring after a tempo change?
+};
@@ -0,0 +1,466 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <numbers>
+#include <ranges>
+#include <span>
+#include <utility>
+
+#include "datatable.h"
+
+// Mipmapped band-limited wavetables
+//
+// Each mip level holds one cycle of each wave shape (frame) with only as many
+// harmonics as fit below the Nyquist frequency for the top of an octave's
+// range of fundamental frequencies, so reading it doesn't alias. The frames
+// are interleaved: each table row holds one sample of every frame, so the
+// two frames either side of a morph position come from the same row read.
+//
+// The tables are calculated at compile time using @ref DataTable, summing the
+// harmonics from a sine table instead of calling sin() for each one. They are
+// stored as Q15 (16-bit) values to save memory.
+
+namespace Wavetable {
+
+/// @brief Wave shapes, in morphing order
+enum Frame : unsigned { Sine, Triangle, Saw, Square, numFrames };
+
+/// @brief One table row: a sample of each frame, in Q15 scaled by 1/headroom
+struct Row
+{
+    int16_t frame[numFrames];
+};
+
+/// @brief Number of mip levels (octaves)
+static constexpr unsigned numLevels = 10;
+
+/// @brief Number of harmonics in mip level 0
+static constexpr unsigned level0Harmonics = 512;
+
+/// @brief Headroom for the overshoot of the saw and square frames (the
+/// square's fundamental alone has a peak of 4/pi)
+static constexpr double headroom = 1.3;
+
+/// @brief Return the number of harmonics in a mip level
+/// @param level
+/// @return
+constexpr unsigned LevelHarmonics(unsigned level) { return level0Harmonics >> level; }
+
+/// @brief Return the number of samples per cycle in a mip level
+/// @details 8 samples per cycle of the highest harmonic, to keep the linear
+/// interpolation error low, but at least 256 and at most 2048 samples. So
+/// level 0 (512 harmonics) is capped at 4 samples per cycle of its highest
+/// harmonic to save memory, levels 1-4 have 8, and the smaller levels have
+/// more.
+/// @param level
+/// @return
+constexpr size_t LevelSize(unsigned level)
+{
+    return std::clamp(size_t(8 * LevelHarmonics(level)), size_t(256), size_t(2048));
+}
+
+/// @brief Size of @ref sineTable: the largest mip level size
+static constexpr size_t sineTableSize = 2048;
+
+/// @brief Calculate one entry of @ref sineTable
+/// @param index
+/// @param numValues
+/// @return
+constexpr double CalcSine(size_t index, size_t numValues)
+{
+    return std::sin(2 * std::numbers::pi * double(index) / double(numValues));
+}
+
+/// @brief One cycle of a sine wave, only used to calculate the mip levels
+/// @details Every harmonic of every row is a sample of this table.
+static constexpr DataTable<double, sineTableSize, CalcSine> sineTable;
+
+/// @brief Calculate one row of the first half cycle of a mip level table
+/// @tparam LEVEL Mip level
+/// @param index Row number, from 0 to half the mip level size
+/// @param numValues Number of rows
+/// @return
+template<unsigned LEVEL>
+constexpr Row CalcHalfRow(size_t index, size_t numValues)
+{
+    constexpr size_t mask = sineTableSize - 1;
+    constexpr unsigned numHarmonics = LevelHarmonics(LEVEL);
+    static_assert(sineTableSize % LevelSize(LEVEL) == 0);
+    // Step through the sine table for each harmonic: sin(kx) for k = 1, 2...
+    const size_t step = index * (sineTableSize / LevelSize(LEVEL));
+    size_t pos = 0;
+    double saw = 0, square = 0, triangle = 0, sign = 1;
+    for (unsigned k = 1; k <= numHarmonics; k += 2) {
+        // Odd harmonic, in all the shapes
+        pos = (pos + step) & mask;
+        double s = sineTable[pos] / k;
+        saw += s;
+        square += s;
+        triangle += sign * s / k;
+        sign = -sign;
+        // Even harmonic, only in the saw
+        pos = (pos + step) & mask;
+        if (k < numHarmonics) {
+            saw += sineTable[pos] / (k + 1);
+        }
+    }
+    // All the frames start at zero and are positive for the first half cycle
+    const double values[numFrames] = {
+        sineTable[step & mask],
+        triangle * 8 / (std::numbers::pi * std::numbers::pi),
+        saw * 2 / std::numbers::pi,
+        square * 4 / std::numbers::pi
+    };
+    Row row{};
+    for (unsigned f = 0; f < numFrames; ++f) {
+        double q15 = values[f] / headroom * 32767;
+        row.frame[f] = int16_t(q15 < 0 ? q15 - 0.5 : q15 + 0.5);
+    }
+    return row;
+}
+
+/// @brief First half cycle of a mip level table, only used to calculate it
+template<unsigned LEVEL>
+static constexpr DataTable<Row, LevelSize(LEVEL) / 2 + 1, CalcHalfRow<LEVEL>> halfTable;
+
+/// @brief Calculate one row of a mip level table
+/// @details All the frames are odd functions, f(-x) = -f(x), so the second
+/// half cycle is the first half backwards and negated. This halves the work
+/// of calculating the tables, which keeps it within the compiler's limit on
+/// constant evaluation. The table has one extra row at the end, a copy of the
+/// first, to help with interpolation.
+/// @tparam LEVEL Mip level
+/// @param index Row number
+/// @param numValues Number of rows
+/// @return
+template<unsigned LEVEL>
+constexpr Row CalcRow(size_t index, size_t numValues)
+{
+    const size_t size = numValues - 1;
+    index %= size;
+    if (index <= size / 2) {
+        return halfTable<LEVEL>[index];
+    }
+    Row row = halfTable<LEVEL>[size - index];
+    for (int16_t& value : row.frame) {
+        value = int16_t(-value);
+    }
+    return row;
+}
+
+/// @brief Table type for a mip level
+template<unsigned LEVEL>
+using LevelTable = DataTable<Row, LevelSize(LEVEL) + 1, CalcRow<LEVEL>>;
+
+/// @brief Table for a mip level
+template<unsigned LEVEL>
+static constexpr LevelTable<LEVEL> levelTable = LevelTable<LEVEL>();
+
+/// @brief Reference to a mip level table
+struct Level
+{
+    const Row* rows;    ///< Table rows, including the extra one
+    uint32_t size;      ///< Number of rows, not including the extra one
+};
+
+/// @brief Make the list of mip level tables
+template<size_t... LEVELS>
+constexpr auto MakeLevels(std::index_sequence<LEVELS...>)
+{
+    return std::array<Level, sizeof...(LEVELS)>{
+        Level{ levelTable<LEVELS>.begin(), uint32_t(LevelSize(LEVELS)) }... };
+}
+
+/// @brief List of all the mip level tables
+static constexpr auto levels = MakeLevels(std::make_index_sequence<numLevels>());
+
+/// @brief Narrowest width, so the warp doesn't speed up part of the cycle
+/// too much
+static constexpr float minWidth = 0.05f;
+
+/// @brief Reads the tables for an oscillator block
+/// @details Works out everything that depends on the oscillator settings
+/// (mip level, morph position and phase warp) once per block. The width warps
+/// the phase so the first half of the cycle takes up that fraction of it.
+/// The warp speeds up part of the cycle, so the mip level is chosen for the
+/// fastest part. Each read is one pair of adjacent rows and one bilinear
+/// interpolation, between the rows and between the frames.
+class Reader
+{
+public:
+    /// @brief Set up for a block
+    /// @param maxInc Largest phase increment (cycles per sample) that will be
+    /// read with
+    /// @param shape Shape in [0, 1]: sine, triangle, saw, square
+    /// @param width Width in [minWidth, 1 - minWidth]: 0.5 for the plain shapes
+    Reader(float maxInc, float shape, float width)
+        : width(width), slopeA(0.5f / width), slopeB(0.5f / (1 - width))
+    {
+        // Mip level 0 has no aliasing up to an increment of 1/(2 * harmonics)
+        int exp;
+        std::frexp(maxInc * std::max(slopeA, slopeB) * float(2 * level0Harmonics), &exp);
+        const Level& level = levels[std::clamp(exp, 0, int(numLevels) - 1)];
+        rows = level.rows;
+        size = float(level.size);
+        mask = level.size - 1;
+
+        // Frames either side of the morph position
+        const float morphPos = shape * (numFrames - 1);
+        frame = std::min(unsigned(morphPos), unsigned(numFrames) - 2);
+        morph = morphPos - float(frame);
+    }
+
+    /// @brief Read the waveform
+    /// @param phase Phase in [0, 1)
+    /// @return
+    float Read(float phase) const
+    {
+        static constexpr float outScale = float(headroom) / 32767.f;
+        float warped = (phase < width) ? phase * slopeA : 0.5f + (phase - width) * slopeB;
+        float pos = warped * size;
+        uint32_t index = uint32_t(pos);
+        float frac = pos - float(index);
+        index &= mask;
+        const Row& row0 = rows[index];
+        const Row& row1 = rows[index + 1];
+        float a0 = row0.frame[frame], b0 = row0.frame[frame + 1];
+        float a1 = row1.frame[frame], b1 = row1.frame[frame + 1];
+        float v0 = a0 + morph * (b0 - a0);
+        float v1 = a1 + morph * (b1 - a1);
+        return (v0 + frac * (v1 - v0)) * outScale;
+    }
+
+private:
+    const Row* rows;    ///< Mip level table
+    float size;         ///< Mip level size
+    uint32_t mask;      ///< Mip level size - 1
+    unsigned frame;     ///< First of the two frames to morph between
+    float morph;        ///< Morph position between the two frames
+    float width;        ///< Phase warp: point where the first half ends
+    float slopeA;       ///< Phase warp: slope of the first half
+    float slopeB;       ///< Phase warp: slope of the second half
+};
+
+} // namespace Wavetable
+
+/// @brief Band-limited wavetable oscillator using @ref Wavetable
+/// @details The shape morphs continuously from sine to triangle, saw and
+/// square. The width warps the phase so the first half of the cycle takes up
+/// that fraction of it: this turns the square into a pulse and the triangle
+/// into a saw or ramp, and skews the other shapes. The tables are read using
+/// @ref Wavetable::Reader.
+///
+/// The mip level changes abruptly at octave boundaries, which can be heard as
+/// a small change in brightness on slow pitch sweeps. Widths away from 0.5
+/// alias more at high frequencies, because the warp changes speed abruptly
+/// part way through the cycle.
+class WavetableOscillator
+{
+public:
+    /// @brief Initialize the oscillator
+    /// @param sampleRate
+    void Init(float sampleRate)
+    {
+        this->sampleRate = sampleRate;
+        phase = 0;
+    }
+
+    /// @brief Set the frequency
+    /// @param freq Frequency in Hz
+    void SetFreq(float freq) { this->freq = freq; }
+
+    /// @brief Set the wave shape
+    /// @param shape Shape in [0, 1]: sine, triangle, saw, square
+    void SetShape(float shape) { this->shape = std::clamp(shape, 0.f, 1.f); }
+
+    /// @brief Set the width
+    /// @param width Width in [0, 1]: 0.5 for the plain shapes
+    void SetWidth(float width)
+    {
+        this->width = std::clamp(width, Wavetable::minWidth, 1 - Wavetable::minWidth);
+    }
+
+    /// @brief Process a block of samples
+    /// @param out
+    void ProcessBlock(std::span<float> out)
+    {
+        const float inc = std::clamp(freq / sampleRate, 0.f, 0.5f);
+        const Wavetable::Reader reader(inc, shape, width);
+        float phase = this->phase;
+        for (float& x : out) {
+            x = reader.Read(phase);
+            phase += inc;
+            if (phase >= 1) {
+                phase -= 1;
+            }
+        }
+        this->phase = phase;
+    }
+
+private:
+    float sampleRate = 48000;
+    float freq = 440;
+    float shape = 0;
+    float width = 0.5f;
+    float phase = 0;                ///< Phase in [0, 1)
+};
+
+/// @brief Unison (supersaw-style) version of @ref WavetableOscillator, with
+/// several detuned voices spread across the stereo field
+/// @details The voices' state is kept in parallel arrays (structure of
+/// arrays), and each output sample is the sum of all the voices, so the inner
+/// loop is just a table read and two multiply-adds per voice. All the voices
+/// read the same mip level, chosen for the highest-pitched one, using a
+/// @ref Wavetable::Reader set up once per block.
+///
+/// The voices are detuned evenly either side of the frequency, by up to
+/// @ref maxDetuneCents, and panned in the same order, so the outermost voices
+/// are the most detuned and the furthest to the sides. The voices start at
+/// different phases so they don't all line up when the oscillator starts.
+class WavetableUnison
+{
+public:
+    /// @brief Largest number of voices
+    static constexpr unsigned maxVoices = 8;
+
+    /// @brief Detune of the outermost voices at full detune, in cents
+    static constexpr float maxDetuneCents = 50;
+
+    /// @brief Initialize the oscillator
+    /// @param sampleRate
+    void Init(float sampleRate)
+    {
+        this->sampleRate = sampleRate;
+        for (unsigned v = 0; v < maxVoices; ++v) {
+            // Spread the starting phases by the golden ratio
+            float start = float(v) * std::numbers::phi_v<float>;
+            phase[v] = start - std::floor(start);
+        }
+        UpdateVoices();
+    }
+
+    /// @brief Set the frequency
+    /// @param freq Frequency in Hz
+    void SetFreq(float freq) { this->freq = freq; }
+
+    /// @brief Set the wave shape
+    /// @param shape Shape in [0, 1]: sine, triangle, saw, square
+    void SetShape(float shape) { this->shape = std::clamp(shape, 0.f, 1.f); }
+
+    /// @brief Set the width
+    /// @param width Width in [0, 1]: 0.5 for the plain shapes
+    void SetWidth(float width)
+    {
+        this->width = std::clamp(width, Wavetable::minWidth, 1 - Wavetable::minWidth);
+    }
+
+    /// @brief Set the number of voices
+    /// @param numVoices Number of voices, from 1 to @ref maxVoices
+    void SetVoices(unsigned numVoices)
+    {
+        numVoices = std::clamp(numVoices, 1u, maxVoices);
+        if (numVoices != this->numVoices) {
+            this->numVoices = numVoices;
+            UpdateVoices();
+        }
+    }
+
+    /// @brief Set the detune
+    /// @param detune Detune in [0, 1]
+    void SetDetune(float detune)
+    {
+        detune = std::clamp(detune, 0.f, 1.f);
+        if (detune != this->detune) {
+            this->detune = detune;
+            UpdateVoices();
+        }
+    }
+
+    /// @brief Set the stereo spread
+    /// @param spread Spread in [0, 1]: 0 for mono, 1 for the outermost voices
+    /// fully left and right
+    void SetSpread(float spread)
+    {
+        spread = std::clamp(spread, 0.f, 1.f);
+        if (spread != this->spread) {
+            this->spread = spread;
+            UpdateVoices();
+        }
+    }
+
+    /// @brief Process a block of samples
+    /// @param left Left output
+    /// @param right Right output (the same size as left)
+    void ProcessBlock(std::span<float> left, std::span<float> right)
+    {
+        const unsigned numVoices = this->numVoices;
+        const float baseInc = freq / sampleRate;
+
+        // Work on local copies of the voice state, so the compiler knows the
+        // output stores can't change it
+        float phases[maxVoices], incs[maxVoices], gainsL[maxVoices], gainsR[maxVoices];
+        float maxInc = 0;
+        for (unsigned v = 0; v < numVoices; ++v) {
+            phases[v] = phase[v];
+            incs[v] = std::clamp(baseInc * ratio[v], 0.f, 0.5f);
+            maxInc = std::max(maxInc, incs[v]);
+            gainsL[v] = gainL[v];
+            gainsR[v] = gainR[v];
+        }
+        const Wavetable::Reader reader(maxInc, shape, width);
+
+        for (auto&& [outL, outR] : std::views::zip(left, right)) {
+            float sumL = 0, sumR = 0;
+            for (unsigned v = 0; v < numVoices; ++v) {
+                float x = reader.Read(phases[v]);
+                sumL += x * gainsL[v];
+                sumR += x * gainsR[v];
+                phases[v] += incs[v];
+                if (phases[v] >= 1) {
+                    phases[v] -= 1;
+                }
+            }
+            outL = sumL;
+            outR = sumR;
+        }
+
+        for (unsigned v = 0; v < numVoices; ++v) {
+            phase[v] = phases[v];
+        }
+    }
+
+private:
+    /// @brief Calculate the voices' frequency ratios and pan gains
+    void UpdateVoices()
+    {
+        // Equal-power pan, scaled so the total power is about the same for
+        // any number of voices
+        const float level = 1 / std::sqrt(float(numVoices));
+        for (unsigned v = 0; v < numVoices; ++v) {
+            // Position from -1 to 1
+            float pos = (numVoices == 1) ? 0 : 2 * float(v) / float(numVoices - 1) - 1;
+            ratio[v] = std::exp2(pos * detune * maxDetuneCents / 1200);
+            float pan = (pos * spread + 1) * std::numbers::pi_v<float> / 4;
+            gainL[v] = std::cos(pan) * level;
+            gainR[v] = std::sin(pan) * level;
+        }
+    }
+
+    float sampleRate = 48000;
+    float freq = 440;
+    float shape = 0;
+    float width = 0.5f;
+    unsigned numVoices = 1;
+    float detune = 0;
+    float spread = 0;
+
+    // Voice state
+    float phase[maxVoices] = { };   ///< Phase in [0, 1)
+    float ratio[maxVoices] = { };   ///< Frequency ratio (detune)
+    float gainL[maxVoices] = { };   ///< Left gain (pan)
+    float gainR[maxVoices] = { };   ///< Right gain (pan)
+};
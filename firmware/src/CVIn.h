@@ -4,6 +4,8 @@
 template<daisy2::DaisySeed2& seed, HWType hwType>
 class CVInBase
 {
+    friend class LookupTestTask; // for access to the CV conversion tables
+
 protected:
     class Gate;
     using Pins = PinDefs<hwType>;
@@ -15,6 +17,9 @@ public:
     static constexpr unsigned Fixed = ADC::_inCount; // for PARAM_CVSOURCE
     static constexpr unsigned Button = 2; // for PARAM_GATESOURCE
 
+    /// @brief Number of CV inputs that can be calibrated (CV1 and CV2 but not Pot)
+    static constexpr unsigned numCalInputs = ADC::Pot;
+
     /// @brief Initialize the ADC inputs for the CVs
     static void Init()
     {
@@ -28,6 +33,7 @@ public:
         }
         seed.adc.Init(adcConfigs, std::size(adcConfigs));
         seed.adc.Start();
+        InitCalibration();
         InitGates();
     }
 
@@ -95,7 +101,7 @@ public:
     /// @return frequency in Hz
     static float GetFrequency(ADC input)
     {
-        return ConvertFreqCvValue(GetRaw(input));
+        return ConvertFreqCvValue(GetRaw(input), input);
     }
 
     /// @brief Returns a frequency from a pitch CV and a modulation CV
@@ -109,18 +115,149 @@ public:
         float cvMod = GetBipolar(inputMod).value_or(0);
         int mod = int(cvMod * modAmount * 800.f);
         uint16_t cvModulated = uint16_t(std::clamp(int(cvPitch) + mod, 0, int(cvRawMax)));
-        return ConvertFreqCvValue(cvModulated);
+        return ConvertFreqCvValue(cvModulated, inputPitch);
     }
 
+    /// @brief MIDI note number for 0V on a 1V-per-octave pitch CV input
+    static constexpr unsigned minNote = 12; // C0
+
     /// @brief Return a MIDI note number corresponding to a 1V-per-octave pitch
     /// CV from the given input
     /// @param input ADC input channel
     /// @return MIDI note number (may be fractional)
     static float GetNote(ADC input)
     {
-        return ConvertNoteCvValue(GetRaw(input));
+        return ConvertNoteCvValue(GetRaw(input), input);
     }
 
+    /// @brief Snapshot of all the CV inputs, taken once per audio callback
+    /// @details Each ADC input is read just once, by Take(). The various
+    /// conversions (bipolar, unipolar, etc.) are only calculated when they
+    /// are asked for, and each one is calculated at most once per snapshot.
+    /// The functions are the same as the static CVInBase functions of the
+    /// same names.
+    class Snapshot
+    {
+    public:
+        /// @brief Read the current values of all the ADC inputs
+        void Take()
+        {
+            for (unsigned input = 0; input < ADC::_inCount; ++input) {
+                raw[input] = CVInBase::GetRaw(ADC(input));
+            }
+            valid = 0;
+        }
+
+        /// @brief Return the ADC value from the given input
+        /// @param input ADC input channel
+        /// @return 16-bit ADC value
+        uint16_t GetRaw(ADC input) const { return raw[input]; }
+
+        /// @brief Return a bipolar CV value from the given ADC input
+        /// @param input ADC input channel, or @ref Fixed
+        /// @return optional float in [-1, +1], or empty
+        std::optional<float> GetBipolar(unsigned input) const
+        {
+            return GetOpt<View::Bipolar>(input);
+        }
+
+        /// @brief Return a unipolar CV value from the given ADC input
+        /// @param input ADC input channel, or @ref Fixed
+        /// @return optional float in [0, +1], or empty
+        std::optional<float> GetUnipolar(unsigned input) const
+        {
+            return GetOpt<View::Unipolar>(input);
+        }
+
+        /// @brief Return a unipolar CV value from the given ADC input, with
+        /// exponential response
+        /// @param input ADC input channel, or @ref Fixed
+        /// @return optional float in [0, +1], or empty
+        std::optional<float> GetUnipolarExp(unsigned input) const
+        {
+            return GetOpt<View::UniExp>(input);
+        }
+
+        /// @brief Return a frequency corresponding to a 1V-per-octave pitch CV
+        /// @param input ADC input channel
+        /// @return frequency in Hz
+        float GetFrequency(ADC input) const { return Get<View::Freq>(input); }
+
+        /// @brief Return a MIDI note number corresponding to a 1V-per-octave pitch CV
+        /// @param input ADC input channel
+        /// @return MIDI note number (may be fractional)
+        float GetNote(ADC input) const { return Get<View::Note>(input); }
+
+        /// @brief Returns a frequency from a pitch CV and a modulation CV
+        /// @param inputPitch 
+        /// @param inputMod 
+        /// @param modAmount 
+        /// @return frequency in Hz
+        float GetFreqWithMod(ADC inputPitch, ADC inputMod, float modAmount) const
+        {
+            if (modAmount == 0) {
+                return GetFrequency(inputPitch);
+            }
+            float cvMod = GetBipolar(inputMod).value_or(0);
+            int mod = int(cvMod * modAmount * 800.f);
+            uint16_t cvModulated = uint16_t(std::clamp(int(raw[inputPitch]) + mod, 0, int(cvRawMax)));
+            return ConvertFreqCvValue(cvModulated, inputPitch);
+        }
+
+    protected:
+        /// @brief The different conversions of the ADC values
+        enum View : uint8_t { Bipolar, Unipolar, UniExp, Note, Freq, _numViews };
+
+        /// @brief Return a converted value, calculating it if necessary
+        /// @tparam view 
+        /// @param input ADC input channel
+        /// @return 
+        template<View view>
+        float Get(ADC input) const
+        {
+            uint16_t bit = uint16_t(1u << (unsigned(view) * ADC::_inCount + input));
+            if (!(valid & bit)) {
+                values[view][input] = Convert<view>(raw[input], input);
+                valid |= bit;
+            }
+            return values[view][input];
+        }
+
+        template<View view>
+        std::optional<float> GetOpt(unsigned input) const
+        {
+            if (input >= ADC::_inCount) {
+                return std::nullopt;
+            } else {
+                return Get<view>(ADC(input));
+            }
+        }
+
+        template<View view>
+        static float Convert(uint16_t cv, ADC input)
+        {
+            if constexpr (view == View::Bipolar) {
+                return ConvertCvBipolar(cv, input);
+            } else if constexpr (view == View::Unipolar) {
+                return ConvertCvUnipolar(cv, input);
+            } else if constexpr (view == View::UniExp) {
+                return ConvertCvUniExp(cv, input);
+            } else if constexpr (view == View::Note) {
+                return ConvertNoteCvValue(cv, input);
+            } else {
+                return ConvertFreqCvValue(cv, input);
+            }
+        }
+
+        uint16_t raw[ADC::_inCount] = { };
+
+        mutable float values[View::_numViews][ADC::_inCount];
+
+        /// @brief Bit flags for the entries in values that have been calculated
+        mutable uint16_t valid = 0;
+        static_assert(unsigned(View::_numViews) * ADC::_inCount <= 16);
+    };
+
 protected:
     /// @brief A single CV input: its GPIO pin and gate tracker
     struct Input
@@ -151,21 +288,21 @@ protected:
         }
     }
 
-    static constexpr float ConvertCvBipolar(uint16_t cv, unsigned input)
+    static float ConvertCvBipolar(uint16_t cv, unsigned input)
     {
-        float val = (input == ADC::Pot) ? ConvertBipolarPotValue(cv) : ConvertBipolarCvValue(cv);
+        float val = (input == ADC::Pot) ? ConvertBipolarPotValue(cv) : ConvertBipolarCvValue(cv, input);
         return std::clamp(val, -1.f, +1.f);
     }
 
-    static constexpr float ConvertCvUnipolar(uint16_t cv, unsigned input)
+    static float ConvertCvUnipolar(uint16_t cv, unsigned input)
     {
-        float val = (input == ADC::Pot) ? ConvertUnipolarPotValue(cv) : ConvertUnipolarCvValue(cv);
+        float val = (input == ADC::Pot) ? ConvertUnipolarPotValue(cv) : ConvertUnipolarCvValue(cv, input);
         return std::clamp(val, 0.f, +1.f);
     }
 
-    static constexpr float ConvertCvUniExp(uint16_t cv, unsigned input)
+    static float ConvertCvUniExp(uint16_t cv, unsigned input)
     {
-        float val = (input == ADC::Pot) ? ConvertUniExpPotValue(cv) : ConvertUniExpCvValue(cv);
+        float val = (input == ADC::Pot) ? ConvertUniExpPotValue(cv) : ConvertUniExpCvValue(cv, input);
         return std::clamp(val, 0.f, +1.f);
     }
 
@@ -173,37 +310,35 @@ protected:
 
     static constexpr unsigned cvRawMax = (1u << numCvBits) - 1;
 
-    // TODO: Values for HWType::Prototype not tested
-    static constexpr uint16_t adcCvZero = isPrototype ? 93 : 31620;
-    static constexpr uint16_t adcCvBiHi = isPrototype ? 31736 : 44890;
-    static constexpr uint16_t adcCvUniHi = isPrototype ? 50777 : 52850;
-
     template<uint16_t inputLo, uint16_t inputHi, float outputLo, float outputHi>
-    static constexpr float ConvertAdcValue(uint16_t adcValue)
+    static constexpr float ConvertAdcValue(unsigned adcValue)
     {
         // NOTE: adcValue may be outside the range of [inputLo, inputHi]
-        // so take care with the artihmetic
+        // so take care with the artihmetic. It is unsigned rather than
+        // uint16_t because the last entry of a lookup table is for 65536.
         return outputLo
                 + (outputHi - outputLo) * (float(adcValue) - float(inputLo))
                     / (float(inputHi) - float(inputLo));
     }
 
-    static constexpr float ConvertBipolarCvValue(uint16_t adcValue)
+    static float ConvertBipolarCvValue(uint16_t adcValue, unsigned input)
     {
         // CV [-5, +5] volts -> [-1, +1]
-        return ConvertAdcValue<adcCvZero, adcCvBiHi, 0.f, +1.f>(adcValue);
+        const Coeffs& c = coeffs[input];
+        return (float(adcValue) - c.adcZero) * c.bipolarScale;
     }
 
-    static constexpr float ConvertUnipolarCvValue(uint16_t adcValue)
+    static float ConvertUnipolarCvValue(unsigned adcValue, unsigned input)
     {
         // CV [0, +8] volts -> [0, +1]
-        return ConvertAdcValue<adcCvZero, adcCvUniHi, 0.f, +1.f>(adcValue);
+        const Coeffs& c = coeffs[input];
+        return (float(adcValue) - c.adcZero) * c.unipolarScale;
     }
 
-    static constexpr float ConvertUniExpCvValue(uint16_t adcValue)
+    static float ConvertUniExpCvValue(uint16_t adcValue, unsigned input)
     {
         // CV [0, +8] volts -> [0, +1] with exponential response
-        return CvExpTable::lookupInterpolate(adcValue);
+        return cvExpTables[input].lookupInterpolate(adcValue);
     }
 
     static constexpr uint16_t adcPotLo = 10;
@@ -215,7 +350,7 @@ protected:
         return ConvertAdcValue<adcPotLo, adcPotHi, -1.f, +1.f>(adcValue);
     }
 
-    static constexpr float ConvertUnipolarPotValue(uint16_t adcValue)
+    static constexpr float ConvertUnipolarPotValue(unsigned adcValue)
     {
         // Pot [0, +3.3] volts -> [0, +1]
         return ConvertAdcValue<adcPotLo, adcPotHi, 0.f, +1.f>(adcValue);
@@ -229,39 +364,23 @@ protected:
 
     /// @brief Convert CV ADC reading to an ocillator frequency with 1V-per-octave scaling
     /// @param cv 
+    /// @param input ADC input channel
     /// @return Oscillator frequency in Hz
-    static constexpr float ConvertFreqCvValue(uint16_t cv)
+    static float ConvertFreqCvValue(uint16_t cv, ADC input)
     {
-        return CVFreqTable::lookupInterpolate(cv);
+        return cvFreqTables[CalIndex(input)].lookupInterpolate(cv);
     }
 
-    static constexpr unsigned minNote = 12; // C0
-    static constexpr unsigned numNotes = isPrototype ? (10 * 12) : (12 * 12);
-    static constexpr unsigned adcCvFreqHi = isPrototype ? 63471 : 63460;
-    static constexpr unsigned adcCvFreqLo = isPrototype ? 93 : 31620;
-
     /// @brief Convert CV ADC reading to a MIDI note with 1V-per-octave scaling
     /// @param cv 
+    /// @param input ADC input channel
     /// @return MIDI note number (may be a fractional value)
-    static constexpr float ConvertNoteCvValue(unsigned cv)
+    static float ConvertNoteCvValue(unsigned cv, unsigned input)
     {
-        return minNote
-            + numNotes * (float(int(cv) - int(adcCvFreqLo)) / float(adcCvFreqHi - adcCvFreqLo));
+        const Coeffs& c = coeffs[CalIndex(input)];
+        return minNote + (float(cv) - c.adcZero) * c.noteScale;
     }
 
-    /// @brief The frequency mapping table has 8192 entries (13-bit index)
-    static constexpr unsigned numFreqTableBits = 13;
-
-    /// @brief CV-to-frequency mapping table
-    /// @note This table should really be in SDRAM but there's currently no way
-    /// to get static initialized data into SDRAM.
-    using CVFreqTable = LookupTable<float, numCvBits, numFreqTableBits,
-        [](size_t index, size_t numValues) {
-            unsigned cv = (index << (numCvBits - numFreqTableBits));
-            float note = ConvertNoteCvValue(cv);
-            return powf(2, (note - 69.0f) / 12.0f) * 440.0f; // daisysp::mtof(note);
-        }>;
-
     /// @brief Map the interval [0,1] to itself with an exponential function
     /// @details This gives an exponential response for a CV or potentiometer
     /// controlling a parameter which works better exponentially, e.g. time.
@@ -275,28 +394,213 @@ protected:
         return factor * (exp2(in * expFactor) - 1);
     }
 
-    /// @brief The exponential-response mapping tables have 128 entries (7-bit index)
-    static constexpr unsigned numExpMapBits = 7;
+// Calibration
+public:
+    /// @brief Calibration settings for a CV input
+    /// @details The ADC response is assumed to be linear, so two values
+    /// determine the conversion for all of the CV ranges (bipolar, unipolar,
+    /// 1V/octave).
+    struct Calibration
+    {
+        float adcZero;      ///< ADC reading for 0V
+        float adcPerVolt;   ///< ADC reading change per volt
+
+        constexpr bool operator==(const Calibration&) const = default;
+    };
+
+    /// @brief Nominal calibration settings, used until real ones are loaded
+    /// @details Measured on a typical unit. TODO: Values for HWType::Prototype not tested
+    static constexpr Calibration defaultCalibration = isPrototype
+        ? Calibration{ .adcZero = 93.f, .adcPerVolt = (63471.f - 93.f) / 10.f }
+        : Calibration{ .adcZero = 31620.f, .adcPerVolt = (63460.f - 31620.f) / 12.f };
+
+    /// @brief Check that calibration settings are plausible
+    /// @details This catches bad measurements and uninitialized flash data.
+    /// @param cal 
+    /// @return true if cal is within 25% of the nominal settings
+    static constexpr bool IsCalibrationValid(const Calibration& cal)
+    {
+        constexpr Calibration nom = defaultCalibration;
+        constexpr float maxZeroDiff = 0.25f * 10.f * nom.adcPerVolt;
+        return cal.adcPerVolt > 0.75f * nom.adcPerVolt
+            && cal.adcPerVolt < 1.25f * nom.adcPerVolt
+            && !isDifferent(cal.adcZero, nom.adcZero, maxZeroDiff);
+    }
+
+    /// @brief Return the current calibration settings for a CV input
+    /// @param input CV1 or CV2
+    /// @return 
+    static Calibration GetCalibration(ADC input) { return calibrations[input]; }
+
+    /// @brief Set the calibration settings for a CV input
+    /// @details This recalculates the conversion coefficients and the lookup
+    /// tables for the input, which takes a few milliseconds.
+    /// Invalid settings are replaced by @ref defaultCalibration.
+    /// @param input CV1 or CV2
+    /// @param cal 
+    static void SetCalibration(ADC input, const Calibration& cal)
+    {
+        if (input >= numCalInputs) {
+            return;
+        }
+        const Calibration& calUse = IsCalibrationValid(cal) ? cal : defaultCalibration;
+        calibrations[input] = calUse;
+        coeffs[input] = {
+            .adcZero = calUse.adcZero,
+            .bipolarScale = 1.f / (voltsBipolar * calUse.adcPerVolt),
+            .unipolarScale = 1.f / (voltsUnipolar * calUse.adcPerVolt),
+            .noteScale = 12.f / calUse.adcPerVolt
+        };
+        cvFreqTables[input].Init(
+            [input](size_t index, size_t numValues) {
+                unsigned cv = (index << CVFreqTable::nBitsShift);
+                float note = ConvertNoteCvValue(cv, input);
+                return powf(2, (note - 69.0f) / 12.0f) * 440.0f; // daisysp::mtof(note);
+            });
+        cvExpTables[input].Init(
+            [input](size_t index, size_t numValues) {
+                auto n = unsigned(index << CvExpTable::nBitsShift);
+                auto fl = ConvertUnipolarCvValue(n, input);
+                fl = ExpResponse(fl);
+                return fl;
+            });
+    }
+
+    /// @brief Return the average of several readings from an ADC input
+    /// @details This takes a while - about count milliseconds.
+    /// @param input ADC input channel
+    /// @param count Number of readings to average
+    /// @return 16-bit ADC value
+    static uint16_t GetRawAverage(ADC input, unsigned count)
+    {
+        unsigned total = 0;
+        for (unsigned i = 0; i < count; ++i) {
+            daisy2::System2::Delay(1);
+            total += GetRaw(input);
+        }
+        return uint16_t((total + count / 2) / count);
+    }
+
+protected:
+    /// @brief Voltage corresponding to bipolar CV value +1
+    static constexpr float voltsBipolar = 5.f;
+
+    /// @brief Voltage corresponding to unipolar CV value +1
+    static constexpr float voltsUnipolar = 8.f;
+
+    /// @brief Current calibration settings for each CV input
+    static inline Calibration calibrations[numCalInputs];
+
+    /// @brief CV conversion coefficients, precalculated from the calibration settings
+    struct Coeffs
+    {
+        float adcZero;
+        float bipolarScale;
+        float unipolarScale;
+        float noteScale;
+    };
+
+    /// @brief Conversion coefficients for each CV input
+    static inline Coeffs coeffs[numCalInputs];
+
+    /// @brief Return the index of the calibration settings to use for an input
+    /// @details Pot is not calibrated so if it's used as a pitch input, just
+    /// use the settings for CV1.
+    /// @param input ADC input channel
+    /// @return 
+    static constexpr unsigned CalIndex(unsigned input)
+    {
+        return (input < numCalInputs) ? input : unsigned(ADC::CV1);
+    }
+
+    /// @brief Initialize the conversions for all the CV inputs with nominal
+    /// calibration settings
+    static void InitCalibration()
+    {
+        for (unsigned input = 0; input < numCalInputs; ++input) {
+            SetCalibration(ADC(input), defaultCalibration);
+        }
+    }
+
+// Lookup Tables
+public:
+    /// @brief Error target for the CV-to-frequency mapping tables: 0.05 cents
+    /// (as a frequency ratio)
+    static constexpr double maxFreqTableError = 0.05 / 1200 * std::numbers::ln2;
+
+    /// @brief Error target for the exponential-response mapping tables
+    static constexpr double maxExpTableError = 0.001;
+
+protected:
+    /// @brief Calibration with the steepest response that @ref
+    /// IsCalibrationValid accepts
+    /// @details The sizes of the tables that depend on the calibration settings
+    /// are chosen using this, so the error targets are met for any calibration.
+    static constexpr Calibration steepestCalibration = {
+        .adcZero = defaultCalibration.adcZero,
+        .adcPerVolt = 0.75f * defaultCalibration.adcPerVolt
+    };
+
+    /// @brief Error measure for the exponential-response tables, whose output
+    /// is clamped to [0, 1]
+    static constexpr double ClampedError(double value, double exact)
+    {
+        return LookupError::Absolute(std::clamp(value, 0., 1.), std::clamp(exact, 0., 1.));
+    }
+
+    /// @brief Sizes the CV-to-frequency mapping tables
+    using CVFreqSizer = LookupTableSizer<float, numCvBits,
+        [](unsigned cv) -> float {
+            constexpr Calibration cal = steepestCalibration;
+            float note = minNote + (float(cv) - cal.adcZero) * 12.f / cal.adcPerVolt;
+            return exp2((note - 69.0f) / 12.0f) * 440.0f;
+        }, Interp::Linear, LookupError::Relative>;
+
+    /// @brief CV-to-frequency mapping table type
+    using CVFreqTable = RuntimeLookupTable<float, numCvBits,
+        CVFreqSizer::template BitsForMaxError<maxFreqTableError>()>;
+
+    /// @brief CV-to-frequency mapping tables for external CV inputs
+    /// @details These are calculated by @ref SetCalibration because they
+    /// depend on the calibration settings.
+    static inline CVFreqTable cvFreqTables[numCalInputs];
 
     /// @brief Exponential CV mapping table for the potentiometer
-    using PotExpTable = LookupTable<float, numCvBits, numExpMapBits,
-        [](size_t index, size_t numValues) {
-            constexpr auto step = (1 << (numCvBits-numExpMapBits));
-            auto n = index * step;
-            auto fl = ConvertUnipolarPotValue(n);
-            fl = ExpResponse(fl);
-            return fl;
-        }>;
-
-    /// @brief Exponential CV mapping table for external CV inputs
-    using CvExpTable = LookupTable<float, numCvBits, numExpMapBits,
-        [](size_t index, size_t numValues) {
-            constexpr auto step = (1 << (numCvBits-numExpMapBits));
-            auto n = index * step;
-            auto fl = ConvertUnipolarCvValue(n);
-            fl = ExpResponse(fl);
-            return fl;
-        }>;
+    using PotExpTable = SizedLookupTable<float, numCvBits,
+        [](unsigned n) { return ExpResponse(ConvertUnipolarPotValue(n)); },
+        maxExpTableError, Interp::Linear, ClampedError>;
+
+    /// @brief Sizes the exponential CV mapping tables
+    using CvExpSizer = LookupTableSizer<float, numCvBits,
+        [](unsigned n) {
+            constexpr Calibration cal = steepestCalibration;
+            return ExpResponse((float(n) - cal.adcZero) / (voltsUnipolar * cal.adcPerVolt));
+        }, Interp::Linear, ClampedError>;
+
+    /// @brief Exponential CV mapping table type
+    using CvExpTable = RuntimeLookupTable<float, numCvBits,
+        CvExpSizer::template BitsForMaxError<maxExpTableError>()>;
+
+    /// @brief Exponential CV mapping tables for external CV inputs
+    /// @details These are calculated by @ref SetCalibration because they
+    /// depend on the calibration settings.
+    static inline CvExpTable cvExpTables[numCalInputs];
+
+public:
+    /// @brief Max error of the CV-to-frequency mapping tables (with the
+    /// steepest valid calibration)
+    static constexpr double freqTableError =
+        CVFreqSizer::template MaxError<CVFreqTable::nBitsTable>();
+    static_assert(freqTableError <= maxFreqTableError);
+
+    /// @brief Max error of the exponential CV mapping tables (with the
+    /// steepest valid calibration)
+    static constexpr double cvExpTableError =
+        CvExpSizer::template MaxError<CvExpTable::nBitsTable>();
+    static_assert(cvExpTableError <= maxExpTableError);
+
+    /// @brief Max error of the exponential potentiometer mapping table
+    static constexpr double potExpTableError = PotExpTable::maxError;
 
 // Gate Input
 public:
@@ -1,10 +1,36 @@
 #pragma once
 
+/// @brief Maximum block size for @ref CVOutBase DMA streaming
+static constexpr size_t cvOutMaxBlockSize = 16;
+
+/// @brief DMA buffers for the CV outputs (double-buffered, per channel)
+/// @details The DAC's DMA stream can only access certain memory regions.
+/// BUG: Should be a static data member in CVOutBase but then it cannot be
+/// stored in the DMA-accessible region (DMA_BUFFER_MEM_SECTION does nothing in
+/// that case).
+static uint16_t DMA_BUFFER_MEM_SECTION cvOutDmaBuffers[2][2 * cvOutMaxBlockSize];
+
 /// @brief Handle analog control voltage outputs
 /// @details There are two DAC output channels.
 /// The full output voltage range is 0V to +10V. Bipolar CV output is not
 /// supported.
-template<daisy2::DaisySeed2& seed>
+///
+/// The DAC is driven by a timer at the audio sample rate and fed by DMA, so
+/// writing an output value never waits for the DAC. Each channel streams
+/// values from a FIFO, which @ref WriteBlock fills with one value per audio
+/// sample (typically from the audio callback). When the FIFO is empty the
+/// channel outputs its hold value, which is the last value written by
+/// @ref WriteBlock or @ref SetRaw.
+///
+/// The DAC timer runs from a different clock than the audio codec, so the two
+/// drift apart slowly. @ref DacCallback corrects for that by keeping the
+/// FIFO between @ref fifoLow and @ref fifoHigh values: it repeats a single
+/// value when the FIFO is low and skips a single value when it is high, which
+/// happens a few times a second at most and hardly changes the output.
+/// @tparam seed Daisy Seed object
+/// @tparam SAMPLE_RATE DAC output sample rate (the audio sample rate)
+/// @tparam BLOCK_SIZE Number of values per block (the audio block size)
+template<daisy2::DaisySeed2& seed, unsigned SAMPLE_RATE, size_t BLOCK_SIZE>
 class CVOutBase
 {
 public:
@@ -13,25 +39,36 @@ public:
     /// @brief Maximum output value for @ref SetRaw
     static constexpr unsigned maxValue = (1 << 12) - 1;
 
-    /// @brief Initialize the CV outputs
+    /// @brief Number of values per block
+    static constexpr size_t blockSize = BLOCK_SIZE;
+    static_assert(blockSize <= cvOutMaxBlockSize);
+
+    /// @brief Initialize the CV outputs and start the DAC
     static void Init()
     {
         daisy::DacHandle::Config dacConfig {
+            .target_samplerate = SAMPLE_RATE,
             .chn = daisy::DacHandle::Channel::BOTH,
-            .mode = daisy::DacHandle::Mode::POLLING,
+            .mode = daisy::DacHandle::Mode::DMA,
             .bitdepth = daisy::DacHandle::BitDepth::BITS_12,
             .buff_state = daisy::DacHandle::BufferState::DISABLED
         };
         seed.dac.Init(dacConfig);
+        seed.dac.Start(cvOutDmaBuffers[0], cvOutDmaBuffers[1], 2 * blockSize, DacCallback);
+        for (unsigned chan = 0; chan < numChannels; ++chan) {
+            SetCalibration(Channel(chan), defaultCalibration);
+        }
     }
 
     /// @brief Set a CV output to a 12-bit value
+    /// @details This sets the channel's hold value, which is output after any
+    /// values queued by @ref WriteBlock.
     /// @param channel DAC output channel
     /// @param value 12-bit unsigned value corresponding to a voltage range of
     /// [0, +10] approximately
     static void SetRaw(Channel channel, unsigned value)
     {
-        seed.dac.WriteValue(channel, value);
+        streams[StreamIndex(channel)].hold.store(uint16_t(value), std::memory_order_relaxed);
     }
 
     /// @brief Set a CV output to a unipolar floating-point value
@@ -39,9 +76,7 @@ public:
     /// @param value float in [0, +1] corresponding to voltage range [0, +8] 
     static void SetUnipolar(Channel channel, float value)
     {
-        value *= 8.f/10.f;
-        unsigned cv = std::round(value * cv10V);
-        SetRaw(channel, cv);
+        SetRaw(channel, ConvertUnipolar(value));
     }
 
     /// @brief Set a pitch CV output to a MIDI note value
@@ -49,8 +84,42 @@ public:
     /// @param note MIDI note number (may be fractional)
     static void SetNote(Channel channel, float note)
     {
-        int cv = std::round((note - float(minNote)) * cv10V / float(numNotes));
-        SetRaw(channel, unsigned(std::clamp(cv, 0, int(maxValue))));
+        SetRaw(channel, ConvertNote(StreamIndex(channel), note));
+    }
+
+    /// @brief Queue a block of 12-bit values for a CV output, one per sample
+    /// @details Any values that don't fit in the FIFO are dropped. That only
+    /// happens if the DAC stops reading it.
+    /// @param channel DAC output channel
+    /// @param values Up to @ref blockSize 12-bit unsigned values
+    static void WriteBlock(Channel channel, std::span<const uint16_t> values)
+    {
+        if (values.empty()) {
+            return;
+        }
+        Stream& stream = streams[StreamIndex(channel)];
+        uint32_t write = stream.writeCount.load(std::memory_order_relaxed);
+        uint32_t read = stream.readCount.load(std::memory_order_acquire);
+        const size_t count = std::min(values.size(), size_t(fifoSize - (write - read)));
+        for (uint16_t value : values.first(count)) {
+            stream.fifo[write++ % fifoSize] = value;
+        }
+        stream.writeCount.store(write, std::memory_order_release);
+        stream.hold.store(values.back(), std::memory_order_relaxed);
+    }
+
+    /// @brief Queue a block of unipolar floating-point values for a CV output
+    /// @param channel DAC output channel
+    /// @param values Up to @ref blockSize floats in [0, +1] corresponding to
+    /// voltage range [0, +8]
+    static void WriteBlockUnipolar(Channel channel, std::span<const float> values)
+    {
+        uint16_t raw[blockSize];
+        size_t count = std::min(values.size(), blockSize);
+        for (size_t i = 0; i < count; ++i) {
+            raw[i] = ConvertUnipolar(values[i]);
+        }
+        WriteBlock(channel, std::span(raw, count));
     }
 
 protected:
@@ -58,4 +127,181 @@ protected:
     static constexpr unsigned minNote = 12; // C0
     static constexpr unsigned numNotes = 10 * 12; // 10 octave range from 0V to 10V
     static constexpr float cv10V = 4162.43; // nominal output value to give +10V
+
+    static constexpr unsigned numChannels = 2;
+
+    /// @brief Convert a unipolar value to a 12-bit output value
+    /// @param value float in [0, +1] corresponding to voltage range [0, +8]
+    /// @return
+    static uint16_t ConvertUnipolar(float value)
+    {
+        int cv = std::round(value * (8.f/10.f) * cv10V);
+        return uint16_t(std::clamp(cv, 0, int(maxValue)));
+    }
+
+    /// @brief Convert a MIDI note to a 12-bit output value
+    /// @param chan DAC output channel index
+    /// @param note MIDI note number (may be fractional)
+    /// @return
+    static uint16_t ConvertNote(size_t chan, float note)
+    {
+        static constexpr float noteScale = float(1u << NoteTable::nBitsShift);
+        static constexpr float noteMax = float((1u << NoteTable::nBitsIn) - 1);
+        unsigned n = unsigned(std::clamp(note * noteScale, 0.f, noteMax));
+        int32_t cv = noteTables[chan].lookupInterpolate(n);
+        return uint16_t((cv + 0x8000) >> 16);
+    }
+
+    /// @brief Number of values that can be queued per channel
+    /// @details This is a power of 2 so the free-running counters below work
+    /// when they wrap around.
+    static constexpr size_t fifoSize = std::bit_ceil(4 * blockSize);
+
+    /// @brief Lowest number of values the FIFO should hold when the DAC
+    /// callback starts
+    /// @details Two blocks, so one audio callback being late doesn't empty it
+    static constexpr size_t fifoLow = 2 * blockSize;
+
+    /// @brief Highest number of values the FIFO should hold when the DAC
+    /// callback starts
+    /// @details The audio and DAC callbacks can come in either order when they
+    /// are close together, so the level can vary by a block without any drift.
+    static constexpr size_t fifoHigh = fifoLow + blockSize;
+    static_assert(fifoHigh + blockSize <= fifoSize);
+
+    /// @brief Output stream for one channel
+    /// @details The FIFO has a single writer (@ref WriteBlock) and a single
+    /// reader (@ref DacCallback), so it needs no locking.
+    struct Stream
+    {
+        uint16_t fifo[fifoSize];
+        std::atomic<uint32_t> writeCount = 0;   ///< Total values written
+        std::atomic<uint32_t> readCount = 0;    ///< Total values read
+        std::atomic<uint16_t> hold = 0;         ///< Output when the FIFO is empty
+    };
+
+    static inline Stream streams[numChannels];
+
+    static constexpr size_t StreamIndex(Channel channel)
+    {
+        return (channel == Channel::TWO) ? 1 : 0;
+    }
+
+// Calibration
+public:
+    /// @brief Number of points measured for calibrating an output
+    static constexpr unsigned numCalPoints = 11;
+
+    /// @brief Return the output value for a calibration point
+    /// @details The points are at 1V intervals (nominally) from 0V, plus the
+    /// maximum output value.
+    /// @param point 0 to numCalPoints-1
+    /// @return
+    static constexpr uint16_t GetCalPointRaw(unsigned point)
+    {
+        return (point < numCalPoints - 1) ? uint16_t(std::round(point * cv10V / 10.f))
+                                          : uint16_t(maxValue);
+    }
+
+    /// @brief Calibration settings for a CV output
+    /// @details The output voltage measured at each calibration point. The DAC
+    /// and output amplifier may not be quite linear, so the voltages are
+    /// interpolated between the points rather than fitted to a straight line.
+    struct Calibration
+    {
+        float volts[numCalPoints];
+
+        constexpr bool operator==(const Calibration&) const = default;
+    };
+
+    /// @brief Nominal calibration settings, used until real ones are loaded
+    static constexpr Calibration defaultCalibration = [] {
+        Calibration cal{};
+        for (unsigned point = 0; point < numCalPoints; ++point) {
+            cal.volts[point] = GetCalPointRaw(point) * 10.f / cv10V;
+        }
+        return cal;
+    }();
+
+    /// @brief Check that calibration settings are plausible
+    /// @details This catches bad measurements (e.g. the output isn't connected)
+    /// and uninitialized flash data.
+    /// @param cal
+    /// @return true if the voltages increase and are within 0.5V of nominal
+    static constexpr bool IsCalibrationValid(const Calibration& cal)
+    {
+        static constexpr float maxDiff = 0.5f;
+        for (unsigned point = 0; point < numCalPoints; ++point) {
+            if (!(cal.volts[point] > -maxDiff) // also catches NaN
+                || isDifferent(cal.volts[point], defaultCalibration.volts[point], maxDiff)
+                || (point > 0 && !(cal.volts[point] > cal.volts[point - 1]))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// @brief Set the calibration settings for a CV output
+    /// @details This recalculates the note table for the output.
+    /// Invalid settings are replaced by @ref defaultCalibration.
+    /// @param channel DAC output channel (ONE or TWO)
+    /// @param cal
+    static void SetCalibration(Channel channel, const Calibration& cal)
+    {
+        const Calibration& calUse = IsCalibrationValid(cal) ? cal : defaultCalibration;
+        noteTables[StreamIndex(channel)].Init(
+            [&calUse](size_t index, size_t numValues) {
+                // Find the output value for the note's voltage by interpolating
+                // between (or extrapolating from) the nearest calibration points
+                float volts = (float(index) - float(minNote)) / 12.f;
+                unsigned point = 1;
+                while (point < numCalPoints - 1 && calUse.volts[point] < volts) {
+                    ++point;
+                }
+                float v0 = calUse.volts[point - 1];
+                float v1 = calUse.volts[point];
+                float raw0 = GetCalPointRaw(point - 1);
+                float raw1 = GetCalPointRaw(point);
+                float raw = raw0 + (volts - v0) * (raw1 - raw0) / (v1 - v0);
+                raw = std::clamp(raw, 0.f, float(maxValue));
+                return int32_t(std::round(raw * 65536.f));
+            });
+    }
+
+protected:
+    /// @brief MIDI note to output value table type
+    /// @details The input is a MIDI note number in [0, 128) with 9 fraction
+    /// bits. The table has one entry per note and the output values are Q16
+    /// fixed-point.
+    using NoteTable = RuntimeLookupTable<int32_t, 16, 7, Interp::LinearQ16>;
+
+    /// @brief Note tables for each output, calculated by @ref SetCalibration
+    static inline NoteTable noteTables[numChannels];
+
+    /// @brief Fill the next half of the DMA buffers
+    /// @details Called from the DAC's DMA interrupt. If the FIFO runs out, the
+    /// hold value (the last value queued) is repeated.
+    /// @param out Buffers for each channel
+    /// @param size Number of values for each channel
+    static void DacCallback(uint16_t** out, size_t size)
+    {
+        for (size_t chan = 0; chan < std::size(streams); ++chan) {
+            Stream& stream = streams[chan];
+            uint32_t read = stream.readCount.load(std::memory_order_relaxed);
+            uint32_t write = stream.writeCount.load(std::memory_order_acquire);
+            uint16_t hold = stream.hold.load(std::memory_order_relaxed);
+            const uint32_t count = write - read;
+            size_t i = 0;
+            // Correct for clock drift a single value at a time
+            if (count > fifoHigh) {
+                ++read;
+            } else if (count > 0 && count < fifoLow) {
+                out[chan][i++] = stream.fifo[read % fifoSize];
+            }
+            for (; i < size; ++i) {
+                out[chan][i] = (read != write) ? stream.fifo[read++ % fifoSize] : hold;
+            }
+            stream.readCount.store(read, std::memory_order_release);
+        }
+    }
 };
@@ -0,0 +1,191 @@
+#pragma once
+
+/// @brief Calibration settings that are saved in QSPI flash
+struct CalibrationData
+{
+    /// @brief Version number of this struct's layout - change it whenever the
+    /// layout changes so that old saved settings are discarded
+    static constexpr uint32_t currentVersion = 2;
+
+    uint32_t version = currentVersion;
+
+    /// @brief CV input calibration settings for CV1 and CV2
+    HW::CVIn::Calibration cvIn[HW::CVIn::numCalInputs] = {
+        HW::CVIn::defaultCalibration, HW::CVIn::defaultCalibration
+    };
+
+    /// @brief CV output calibration settings for outputs 1 and 2
+    HW::CVOut::Calibration cvOut[2] = {
+        HW::CVOut::defaultCalibration, HW::CVOut::defaultCalibration
+    };
+
+    bool operator==(const CalibrationData&) const = default;
+};
+
+/// @brief CV calibration
+/// @details The calibration settings are loaded from QSPI flash at startup.
+/// If the pushbutton is held down at startup, the calibration procedure is run
+/// to measure new settings. The procedure prompts for known reference voltages
+/// to be applied to each CV input in turn, then for each CV output to be
+/// connected to CV input 1 so the output voltages can be measured.
+class Calibration
+{
+public:
+    /// @brief Load the calibration settings from flash and apply them
+    /// @details If no valid settings have been saved, nominal settings are used.
+    static void Init()
+    {
+        storage.Init(CalibrationData{}, HW::qspiCalibrationOffset);
+        if (storage.GetSettings().version != CalibrationData::currentVersion) {
+            storage.RestoreDefaults();
+        }
+        Apply(storage.GetSettings());
+    }
+
+    /// @brief Check if the calibration procedure has been requested
+    /// @return true if the pushbutton is being held down
+    static bool IsRequested() { return HW::button.IsOn(); }
+
+    /// @brief Run the interactive calibration procedure
+    /// @details This must be called before audio processing is started because
+    /// it takes over the display and pushbutton and it takes a while.
+    /// The new settings are saved in flash and applied.
+    static void Run()
+    {
+        ShowMessage("CV calibration"sv, "Release button"sv);
+        while (HW::button.IsOn())
+            ;
+        HW::button.TurnedOn(); // clear any pending button press
+
+        CalibrationData& data = storage.GetSettings();
+        for (unsigned i = 0; i < HW::CVIn::numCalInputs; ++i) {
+            auto input = HW::CVIn::ADC(i);
+            if (HW::hwType == HWType::Prototype && input == HW::CVIn::CV2) {
+                continue; // the prototype hardware has no CV2 input
+            }
+            auto cal = MeasureInput(input);
+            if (cal) {
+                data.cvIn[i] = *cal;
+            } else {
+                ShowMessage(inputNames[i], "Bad reading!"sv);
+                HW::Sys::Delay(messageDelayMs);
+            }
+        }
+        for (unsigned i = 0; i < std::size(data.cvOut); ++i) {
+            auto cal = MeasureOutput(HW::CVOut::Channel(i), data.cvIn[HW::CVIn::CV1]);
+            if (cal) {
+                data.cvOut[i] = *cal;
+            } else {
+                ShowMessage(outputNames[i], "Bad reading!"sv);
+                HW::Sys::Delay(messageDelayMs);
+            }
+        }
+        data.version = CalibrationData::currentVersion;
+        storage.Save();
+        Apply(data);
+        ShowMessage("CV calibration"sv, "Saved"sv);
+        HW::Sys::Delay(messageDelayMs);
+    }
+
+protected:
+    /// @brief Reference voltages to apply to the CV inputs during calibration
+    static constexpr float refVolts[] = { 1.f, 3.f };
+
+    /// @brief Number of ADC readings to average for each measurement
+    static constexpr unsigned numReadings = 500;
+
+    /// @brief How long to display messages (ms)
+    static constexpr unsigned messageDelayMs = 2'000;
+
+    /// @brief Number of ADC readings to average for each CV output measurement
+    static constexpr unsigned numOutputReadings = 100;
+
+    /// @brief How long to wait for a CV output to settle (ms)
+    static constexpr unsigned settleDelayMs = 20;
+
+    static constexpr std::string_view inputNames[] = { "CV1"sv, "CV2"sv };
+    static constexpr std::string_view outputNames[] = { "OUT1"sv, "OUT2"sv };
+
+    /// @brief Measure the calibration settings for a CV input
+    /// @param input CV1 or CV2
+    /// @return the new settings, or empty if the measurements don't make sense
+    static std::optional<HW::CVIn::Calibration> MeasureInput(HW::CVIn::ADC input)
+    {
+        static constexpr std::string_view prompts[] = { "Apply 1V, press"sv, "Apply 3V, press"sv };
+        static_assert(std::size(prompts) == std::size(refVolts));
+        float adcValues[std::size(refVolts)];
+        for (size_t i = 0; i < std::size(refVolts); ++i) {
+            // Prompt for the reference voltage and wait for the button
+            ShowMessage(inputNames[input], prompts[i]);
+            while (!HW::button.TurnedOn())
+                ;
+            ShowMessage(inputNames[input], "Measuring..."sv);
+            adcValues[i] = HW::CVIn::GetRawAverage(input, numReadings);
+        }
+        HW::CVIn::Calibration cal;
+        cal.adcPerVolt = (adcValues[1] - adcValues[0]) / (refVolts[1] - refVolts[0]);
+        cal.adcZero = adcValues[0] - refVolts[0] * cal.adcPerVolt;
+        if (HW::CVIn::IsCalibrationValid(cal)) {
+            return cal;
+        } else {
+            return std::nullopt;
+        }
+    }
+
+    /// @brief Measure the calibration settings for a CV output
+    /// @details The output must be connected to CV input 1, which must already
+    /// be calibrated.
+    /// @param channel DAC output channel (ONE or TWO)
+    /// @param calIn calibration settings for CV input 1
+    /// @return the new settings, or empty if the measurements don't make sense
+    static std::optional<HW::CVOut::Calibration> MeasureOutput(HW::CVOut::Channel channel,
+        const HW::CVIn::Calibration& calIn)
+    {
+        static constexpr std::string_view prompts[] = { "OUT1 to CV1, press"sv, "OUT2 to CV1, press"sv };
+        ShowMessage(outputNames[unsigned(channel)], prompts[unsigned(channel)]);
+        while (!HW::button.TurnedOn())
+            ;
+        ShowMessage(outputNames[unsigned(channel)], "Measuring..."sv);
+        HW::CVOut::Calibration cal;
+        for (unsigned point = 0; point < HW::CVOut::numCalPoints; ++point) {
+            HW::CVOut::SetRaw(channel, HW::CVOut::GetCalPointRaw(point));
+            HW::Sys::Delay(settleDelayMs);
+            float adcValue = HW::CVIn::GetRawAverage(HW::CVIn::CV1, numOutputReadings);
+            cal.volts[point] = (adcValue - calIn.adcZero) / calIn.adcPerVolt;
+        }
+        HW::CVOut::SetRaw(channel, 0);
+        if (HW::CVOut::IsCalibrationValid(cal)) {
+            return cal;
+        } else {
+            return std::nullopt;
+        }
+    }
+
+    /// @brief Apply calibration settings
+    /// @param data
+    static void Apply(const CalibrationData& data)
+    {
+        for (unsigned i = 0; i < HW::CVIn::numCalInputs; ++i) {
+            HW::CVIn::SetCalibration(HW::CVIn::ADC(i), data.cvIn[i]);
+        }
+        for (unsigned i = 0; i < std::size(data.cvOut); ++i) {
+            HW::CVOut::SetCalibration(HW::CVOut::Channel(i), data.cvOut[i]);
+        }
+    }
+
+    /// @brief Display a two-line message
+    /// @param line1
+    /// @param line2
+    static void ShowMessage(std::string_view line1, std::string_view line2)
+    {
+        HW::display.Fill(false);
+        HW::display.SetCursor(0, 0);
+        HW::display.WriteString(line1, true);
+        HW::display.SetCursor(0, HW::display.GetFont()->FontHeight);
+        HW::display.WriteString(line2, true);
+        HW::display.Update();
+    }
+
+    /// @brief Calibration settings storage in QSPI flash
+    static inline daisy::PersistentStorage<CalibrationData> storage{HW::seed.qspi};
+};
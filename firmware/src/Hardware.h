@@ -15,6 +15,17 @@ public:
     /// @brief The Daisy Seed object
     static inline daisy2::DaisySeed2 seed;
 
+    /// @brief Sample rate for audio processing
+    /// @details Compile-time constant that matches @ref daisy::DaisySeed::AudioSampleRate
+    static constexpr unsigned sampleRate = 48000u;
+
+    /// @brief Sample rate setting corresponding to @ref sampleRate
+    static constexpr daisy::SaiHandle::Config::SampleRate sampleRateSetting =
+        daisy::SaiHandle::Config::SampleRate::SAI_48KHZ;
+
+    /// @brief Block size for audio processing
+    static constexpr size_t audioBlockSize = 4;
+
     /// @brief GPIO pin definitions
     using Pins = PinDefs<hwType>;
 
@@ -33,18 +44,27 @@ public:
     using CVIn = CVInBase<seed, hwType>;
 
     /// @brief Control voltage outputs
-    using CVOut = CVOutBase<seed>;
+    using CVOut = CVOutBase<seed, sampleRate, audioBlockSize>;
 
-    /// @brief Sample rate for audio processing
-    /// @details Compile-time constant that matches @ref daisy::DaisySeed::AudioSampleRate
-    static constexpr unsigned sampleRate = 48000u;
+    /// @brief Offset in QSPI flash of the saved calibration settings
+    /// @details The Daisy bootloader keeps the program near the start of QSPI
+    /// flash so saved data goes near the end, well out of the way.
+    static constexpr uint32_t qspiCalibrationOffset = 0x7F0000;
 
-    /// @brief Sample rate setting corresponding to @ref sampleRate
-    static constexpr daisy::SaiHandle::Config::SampleRate sampleRateSetting =
-        daisy::SaiHandle::Config::SampleRate::SAI_48KHZ;
+    /// @brief Offset in QSPI flash of the impulse response for ProgConvolve
+    /// @details Written separately from the program, by tools/ir2qspi.py
+    static constexpr uint32_t qspiImpulseResponseOffset = 0x400000;
 
-    /// @brief Block size for audio processing
-    static constexpr size_t audioBlockSize = 4;
+    /// @brief Size of the QSPI flash area for the impulse response, in bytes
+    static constexpr uint32_t qspiImpulseResponseSize = 0x100000;
+
+    /// @brief Offset in QSPI flash of the sample bank for ProgSampleDrums
+    /// @details Written separately from the program, by tools/samples2qspi.py
+    static constexpr uint32_t qspiSampleBankOffset = 0x500000;
+
+    /// @brief Size of the QSPI flash area for the sample bank, in bytes (up to
+    /// the saved calibration settings)
+    static constexpr uint32_t qspiSampleBankSize = qspiCalibrationOffset - qspiSampleBankOffset;
 
 public:
     /// @brief Initialize the Daisy Seed hardware and various attached devices
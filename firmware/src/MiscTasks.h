@@ -99,6 +99,7 @@ private:
 
 /// @brief @ref tasks::Task that prints (via serial output) ADC values to help
 /// with CV input calibration
+/// @see Calibration for the calibration procedure that saves settings in flash
 class AdcCalibrateTask : public tasks::Task
 {
 public:
@@ -110,13 +111,7 @@ public:
     {
         // Get an average value
         if (std::abs(int(HW::CVIn::GetRaw(HW::CVIn::CV1)) - int(adcPrev)) >= 500) {
-            static constexpr int iters = 1000;
-            unsigned adcTotal = 0;
-            for (int i = 0; i < iters; ++i) {
-                HW::Sys::Delay(1);
-                adcTotal += HW::CVIn::GetRaw(HW::CVIn::CV1);
-            }
-            unsigned adcAvg = int(float(adcTotal) / float(iters) + 0.5);
+            unsigned adcAvg = HW::CVIn::GetRawAverage(HW::CVIn::CV1, 1000);
             HW::seed.PrintLine("%u", adcAvg);
             adcPrev = adcAvg;
         }
@@ -147,3 +142,797 @@ public:
 protected:
     HW::Sys::timeus_t tStart = 0;
 };
+
+/// @brief @ref tasks::Task that prints (via serial output) the CPU load of the
+/// audio processing callback, for benchmarking the current @ref Program
+class CpuLoadTask : public tasks::Task
+{
+public:
+    unsigned intervalMicros() const { return 1'000'000; }
+
+    void init()
+    {
+        programs.GetCpuLoadMeter().Init(HW::sampleRate, HW::audioBlockSize);
+    }
+
+    void execute()
+    {
+        auto& meter = programs.GetCpuLoadMeter();
+        auto [avgInt, avgFrac] = splitFloat(meter.GetAvgCpuLoad() * 100.f, 2);
+        auto [maxInt, maxFrac] = splitFloat(meter.GetMaxCpuLoad() * 100.f, 2);
+        auto prog = programs.GetCurrentProgram();
+        auto name = prog ? prog->GetName() : "none"sv;
+        daisy2::DebugLog::PrintLine("%.*s: cpu avg=%d.%02u%% max=%d.%02u%%",
+            int(name.size()), name.data(), avgInt, avgFrac, maxInt, maxFrac);
+        meter.Reset();
+    }
+};
+
+/// @brief Base class for the @ref tasks::Task classes below that time DSP code
+class SpeedTestTask : public tasks::Task
+{
+protected:
+    /// @brief Convert the time taken by a test to CPU cycles per item
+    /// @param tElapsed Time in microseconds
+    /// @param count Number of items processed, e.g. samples or blocks
+    /// @return
+    static float CyclesPer(uint32_t tElapsed, size_t count)
+    {
+        const float cyclesPerUs = float(HW::Sys::GetSysClkFreq()) / 1e6f;
+        return float(tElapsed) * cyclesPerUs / float(count);
+    }
+
+    /// @brief Destination for test output, so the compiler can't optimize the
+    /// code under test away
+    static inline volatile float sink = 0;
+};
+
+/// @brief @ref tasks::Task that compares the accuracy and speed of the
+/// @ref LookupTable interpolation modes, using the CV conversion tables
+/// @details Each time it runs it tests one table and prints (via serial output)
+/// for each interpolation mode: the max error compared to the exact conversion
+/// function over all 65536 input values, and the CPU cycles per lookup for
+/// scalar and block lookups.
+class LookupTestTask : public SpeedTestTask
+{
+    using CVIn = HW::CVIn;
+
+public:
+    unsigned intervalMicros() const { return 3'000'000; }
+
+    void init() { }
+
+    void execute()
+    {
+        static constexpr auto cv = CVIn::CV1;
+        switch (testIndex) {
+        case 0:
+            // Frequency error as a ratio (relative error)
+            TestTable<CVIn::CVFreqTable>("CVFreq"sv, CVIn::cvFreqTables[cv].data(), true,
+                [](unsigned n) {
+                    float note = CVIn::ConvertNoteCvValue(n, cv);
+                    return powf(2, (note - 69.0f) / 12.0f) * 440.0f;
+                });
+            break;
+        case 1:
+            TestTable<CVIn::PotExpTable>("PotExp"sv, CVIn::PotExpTable::data(), false,
+                [](unsigned n) {
+                    return CVIn::ExpResponse(CVIn::ConvertUnipolarPotValue(n));
+                });
+            break;
+        case 2:
+            TestTable<CVIn::CvExpTable>("CvExp"sv, CVIn::cvExpTables[cv].data(), false,
+                [](unsigned n) {
+                    return CVIn::ExpResponse(CVIn::ConvertUnipolarCvValue(n, cv));
+                });
+            break;
+        }
+        testIndex = (testIndex + 1) % 3;
+    }
+
+protected:
+    unsigned testIndex = 0;
+
+    /// @brief Fixed-point copy of the table being tested
+    static inline int32_t q16Table[std::max({ CVIn::CVFreqTable::tableSize,
+        CVIn::PotExpTable::tableSize, CVIn::CvExpTable::tableSize }) + 1];
+
+    /// @brief Number of input values per block for the speed test
+    static constexpr size_t blockSize = 256;
+
+    /// @brief Number of blocks for the speed test
+    static constexpr unsigned numBlocks = 64;
+
+    /// @brief Gives access to the interpolation functions for a table with the
+    /// same size as TABLE but a different interpolation mode
+    template<typename TABLE, typename VALUE_T, typename INTERP>
+    struct Interpolator : public LookupTableBase<VALUE_T, TABLE::nBitsIn, TABLE::nBitsTable, INTERP>
+    {
+        using base_t = LookupTableBase<VALUE_T, TABLE::nBitsIn, TABLE::nBitsTable, INTERP>;
+        using base_t::interpolate;
+        using base_t::interpolateBlock;
+    };
+
+    /// @brief Test all the interpolation modes for a table
+    /// @param name Table name to print
+    /// @param table Table values
+    /// @param relative true to print relative errors, false for absolute errors
+    /// @param funcExact Exact conversion function
+    template<typename TABLE>
+    static void TestTable(std::string_view name, const float* table, bool relative,
+                          auto funcExact)
+    {
+        TestMode<Interpolator<TABLE, float, Interp::Legacy>>(name, "legacy"sv, table, relative, funcExact);
+        TestMode<Interpolator<TABLE, float, Interp::Nearest>>(name, "nearest"sv, table, relative, funcExact);
+        TestMode<Interpolator<TABLE, float, Interp::Linear>>(name, "linear"sv, table, relative, funcExact);
+
+        // Make a Q16 fixed-point copy of the table for the LinearQ16 mode, if
+        // the table values are in range
+        static constexpr float q16Max = float(std::numeric_limits<int32_t>::max()) / 65536.f;
+        if (std::any_of(table, table + TABLE::tableSize + 1,
+                        [](float val) { return std::abs(val) >= q16Max; })) {
+            daisy2::DebugLog::PrintLine("%.*s Q16: out of range", int(name.size()), name.data());
+            return;
+        }
+        for (size_t i = 0; i <= TABLE::tableSize; ++i) {
+            q16Table[i] = int32_t(std::round(table[i] * 65536.f));
+        }
+        TestMode<Interpolator<TABLE, int32_t, Interp::LinearQ16>>(name, "Q16"sv, q16Table, relative, funcExact);
+    }
+
+    /// @brief Test one interpolation mode for a table
+    template<typename INTERPOLATOR, typename VALUE_T>
+    static void TestMode(std::string_view name, std::string_view modeName,
+                         const VALUE_T* table, bool relative, auto funcExact)
+    {
+        static constexpr float scale = std::is_integral_v<VALUE_T> ? 1.f / 65536.f : 1.f;
+
+        // Accuracy
+        float maxErr = 0;
+        for (unsigned n = 0; n <= 0xFFFF; ++n) {
+            float exact = funcExact(n);
+            float err = std::abs(float(INTERPOLATOR::interpolate(table, n)) * scale - exact);
+            if (relative) {
+                err /= std::max(std::abs(exact), 1e-6f);
+            }
+            maxErr = std::max(maxErr, err);
+        }
+
+        // Speed - input values spread over the whole table
+        static uint16_t in[blockSize];
+        static VALUE_T out[blockSize];
+        for (size_t i = 0; i < blockSize; ++i) {
+            in[i] = uint16_t(i * 40503u); // golden ratio * 2^16
+        }
+        uint32_t tStart = HW::Sys::GetUs();
+        for (unsigned block = 0; block < numBlocks; ++block) {
+            for (size_t i = 0; i < blockSize; ++i) {
+                out[i] = INTERPOLATOR::interpolate(table, in[i]);
+            }
+            sink = float(out[block % blockSize]);
+        }
+        float cyclesScalar = CyclesPer(HW::Sys::GetUs() - tStart, numBlocks * blockSize);
+        tStart = HW::Sys::GetUs();
+        for (unsigned block = 0; block < numBlocks; ++block) {
+            INTERPOLATOR::interpolateBlock(table, in, out);
+            sink = float(out[block % blockSize]);
+        }
+        float cyclesBlock = CyclesPer(HW::Sys::GetUs() - tStart, numBlocks * blockSize);
+
+        auto [scalarInt, scalarFrac] = splitFloat(cyclesScalar, 2);
+        auto [blockInt, blockFrac] = splitFloat(cyclesBlock, 2);
+        daisy2::DebugLog::PrintLine("%.*s %.*s: max err=%u ppm%s, cycles/lookup: scalar=%d.%02u block=%d.%02u",
+            int(name.size()), name.data(), int(modeName.size()), modeName.data(),
+            unsigned(std::round(maxErr * 1e6f)), relative ? " (relative)" : "",
+            scalarInt, scalarFrac, blockInt, blockFrac);
+    }
+};
+
+// BUG: delayTestStaging should be a static data member in DelayTestTask but
+// then it cannot be stored in DTCM (DTCM_MEM_SECTION does nothing in that case).
+
+/// @brief Staging buffer for @ref DelayTestTask, separate from
+/// @ref ProgDelay's because that one is in use whenever the program is running
+static float DTCM_MEM_SECTION delayTestStaging[delayStagingSize];
+
+/// @brief @ref tasks::Task that measures the speed of the multi-tap delay
+/// buffer reads, with and without staging through DTCM
+/// @details Each time it runs it prints (via serial output) the CPU cycles per
+/// output sample for 1, 4 and 8 taps at long delay times, with the delay time
+/// ramping as it does when modulated. The reads are from @ref ProgDelay's
+/// SDRAM delay buffer, which the task never writes, so the timing includes
+/// the same SDRAM accesses as the program's.
+class DelayTestTask : public SpeedTestTask
+{
+public:
+    unsigned intervalMicros() const { return 2'000'000; }
+
+    void init() { }
+
+    void execute()
+    {
+        for (size_t numTaps : { 1u, 4u, 8u }) {
+            float direct = TestReads(numTaps, { });
+            float staged = TestReads(numTaps, delayTestStaging);
+            auto [directInt, directFrac] = splitFloat(direct, 1);
+            auto [stagedInt, stagedFrac] = splitFloat(staged, 1);
+            daisy2::DebugLog::PrintLine("delay %u taps: cycles/sample direct=%d.%u staged=%d.%u",
+                unsigned(numTaps), directInt, directFrac, stagedInt, stagedFrac);
+        }
+    }
+
+protected:
+    /// @brief Number of blocks for each test
+    static constexpr unsigned numBlocks = 1024;
+
+    /// @brief Longest delay time tested, in samples
+    static constexpr float maxTestDelay = float(DelayBuffer::maxDelay) * 0.9f;
+
+    /// @brief Time reading the delay buffer for a number of taps
+    /// @param numTaps
+    /// @param staging Staging buffer, or empty to read directly
+    /// @return CPU cycles per output sample
+    static float TestReads(size_t numTaps, std::span<float> staging)
+    {
+        static constexpr size_t blockSize = HW::audioBlockSize;
+        float out[blockSize];
+        float delay = maxTestDelay;
+        uint32_t tStart = HW::Sys::GetUs();
+        for (unsigned block = 0; block < numBlocks; ++block) {
+            // Ramp up and down by one sample per block
+            float delayNext = delay + ((block & 0x100) ? 1.f : -1.f);
+            for (size_t tap = numTaps; tap > 0; --tap) {
+                float time = float(tap) / numTaps;
+                delayBuffer.ReadBlock(out, delay * time, delayNext * time, staging);
+                sink = out[0];
+            }
+            delay = delayNext;
+        }
+        return CyclesPer(HW::Sys::GetUs() - tStart, numBlocks * blockSize);
+    }
+};
+
+/// @brief @ref tasks::Task that compares the speed of the @ref BitCrusher
+/// block kernel with the per-sample loop that ProgBitcrush used before it
+/// @details Each time it runs it prints (via serial output) the CPU cycles per
+/// sample for both, at a few bit depths and crushed sample rates, and for the
+/// kernel with 2x and 4x oversampling. Both process the same block of sine
+/// wave over and over, so the timings differ only by the code under test.
+class BitcrushTestTask : public SpeedTestTask
+{
+public:
+    unsigned intervalMicros() const { return 2'000'000; }
+
+    void init()
+    {
+        // Test input: a sine wave
+        for (size_t i = 0; i < blockSize; ++i) {
+            float x = 0.8f * std::sin(2.f * std::numbers::pi_v<float> * float(i) / float(blockSize));
+            input[i] = { x, x };
+        }
+    }
+
+    void execute()
+    {
+        for (auto [bits, rate] : { std::pair(8u, 10000.f), std::pair(4u, 2000.f), std::pair(12u, 48000.f) }) {
+            auto [oldInt, oldFrac] = splitFloat(TestLoop(bits, rate), 1);
+            auto [newInt, newFrac] = splitFloat(TestKernel(bits, rate, 1), 1);
+            auto [x2Int, x2Frac] = splitFloat(TestKernel(bits, rate, 2), 1);
+            auto [x4Int, x4Frac] = splitFloat(TestKernel(bits, rate, 4), 1);
+            daisy2::DebugLog::PrintLine("bitcrush %u bits %uHz: cycles/sample loop=%d.%u kernel=%d.%u 2x=%d.%u 4x=%d.%u",
+                bits, unsigned(rate), oldInt, oldFrac, newInt, newFrac, x2Int, x2Frac, x4Int, x4Frac);
+        }
+    }
+
+protected:
+    static constexpr size_t blockSize = HW::audioBlockSize;
+
+    /// @brief Number of blocks for each test
+    static constexpr unsigned numBlocks = 4096;
+
+    /// @brief Time the per-sample loop that ProgBitcrush used before
+    /// @ref BitCrusher
+    /// @param bitDepth
+    /// @param rate
+    /// @return CPU cycles per sample
+    float TestLoop(unsigned bitDepth, float rate)
+    {
+        daisysp::Metro sampler;
+        sampler.Init(rate, HW::sampleRate);
+        daisy2::AudioSample lastSample{};
+        uint32_t tStart = HW::Sys::GetUs();
+        for (unsigned block = 0; block < numBlocks; ++block) {
+            for (auto&& [in, out] : std::views::zip(input, output)) {
+                if (sampler.Process()) {
+                    unsigned bitMask = 0xFFFFu << (16 - bitDepth);
+                    unsigned sample = std::abs(in.left) * 65536;
+                    sample &= bitMask;
+                    float flSample = float(sample) / 65536.f;
+                    lastSample.left = lastSample.right = std::copysign(flSample, in.left);
+                }
+                out = lastSample;
+            }
+            sink = output[block % blockSize].left;
+        }
+        return CyclesPer(HW::Sys::GetUs() - tStart, numBlocks * blockSize);
+    }
+
+    /// @brief Time the @ref BitCrusher block kernel
+    /// @param bitDepth
+    /// @param rate
+    /// @param oversampling Oversampling factor
+    /// @return CPU cycles per sample
+    float TestKernel(unsigned bitDepth, float rate, unsigned oversampling)
+    {
+        BitCrusher crusher;
+        crusher.Init(HW::sampleRate);
+        crusher.SetBitDepth(bitDepth);
+        crusher.SetRate(rate);
+        crusher.SetOversampling(oversampling);
+        uint32_t tStart = HW::Sys::GetUs();
+        for (unsigned block = 0; block < numBlocks; ++block) {
+            crusher.ProcessBlock(input, output);
+            sink = output[block % blockSize].left;
+        }
+        return CyclesPer(HW::Sys::GetUs() - tStart, numBlocks * blockSize);
+    }
+
+    daisy2::AudioSample input[blockSize];
+    daisy2::AudioSample output[blockSize];
+};
+
+/// @brief Size of the FFT used by @ref OscTestTask
+static constexpr size_t oscTestFftSize = 16384;
+
+// BUG: oscTestFft and the buffers should be static data members in OscTestTask
+// but then they cannot be stored in SDRAM (DSY_SDRAM_BSS does nothing in that
+// case).
+
+/// @brief FFT for measuring the oscillators' aliasing in @ref OscTestTask
+static RealFft<oscTestFftSize> DSY_SDRAM_BSS oscTestFft;
+
+/// @brief Oscillator output for @ref OscTestTask
+static float DSY_SDRAM_BSS oscTestSignal[oscTestFftSize];
+
+/// @brief Spectrum of the oscillator output for @ref OscTestTask
+static float DSY_SDRAM_BSS oscTestRe[oscTestFftSize / 2];
+static float DSY_SDRAM_BSS oscTestIm[oscTestFftSize / 2];
+
+/// @brief @ref tasks::Task that compares the classic and wavetable oscillator
+/// engines of @ref ProgVariableOsc
+/// @details Each time it runs it tests the next C note in the 1V/octave CV
+/// range, from C0 to C9, and prints (via serial output) for a square and a
+/// triangle wave the CPU cycles per sample and the aliasing of each engine.
+/// The aliasing is the power of everything that isn't a harmonic, relative to
+/// the total, measured with the frequency rounded to an odd FFT bin so the
+/// harmonics fall exactly on bins and the aliases between them. Both engines
+/// write their output to the SDRAM buffer that the FFT reads, so the cycle
+/// counts include the same cost for storing each sample.
+class OscTestTask : public SpeedTestTask
+{
+public:
+    unsigned intervalMicros() const { return 2'000'000; }
+
+    void init()
+    {
+        oscTestFft.Init();
+    }
+
+    void execute()
+    {
+        const float note = float(HW::CVIn::minNote + 12 * octave);
+        const float exactFreq = 440.f * std::exp2((note - 69.f) / 12.f);
+        // Round to an odd bin
+        const unsigned bin = unsigned(exactFreq * oscTestFftSize / HW::sampleRate) | 1;
+        const float freq = float(bin) * HW::sampleRate / oscTestFftSize;
+
+        // Classic engine: waveshape 1 is a square, 0 a saw/triangle morph
+        // set by the pulse width. Wavetable: shape 1 is a square, 1/3 a
+        // triangle.
+        struct Shape
+        {
+            std::string_view name;
+            float classic;
+            float wavetable;
+        };
+        for (auto [name, classicShape, wtShape] : { Shape{ "square"sv, 1.f, 1.f },
+                                                    Shape{ "triangle"sv, 0.f, 1.f / 3.f } }) {
+            float classicCycles = TestClassic(freq, classicShape);
+            float classicAlias = AliasDb(bin);
+            float wtCycles = TestWavetable(freq, wtShape);
+            float wtAlias = AliasDb(bin);
+            auto [cInt, cFrac] = splitFloat(classicCycles, 1);
+            auto [wInt, wFrac] = splitFloat(wtCycles, 1);
+            daisy2::DebugLog::PrintLine("osc C%u %.*s %uHz: cycles/sample classic=%d.%u wavetable=%d.%u"
+                " alias classic=%ddB wavetable=%ddB",
+                octave, int(name.size()), name.data(), unsigned(freq), cInt, cFrac, wInt, wFrac,
+                int(std::round(classicAlias)), int(std::round(wtAlias)));
+        }
+        octave = (octave + 1) % numOctaves;
+    }
+
+protected:
+    /// @brief Number of octaves tested, C0 to C9
+    static constexpr unsigned numOctaves = 10;
+
+    /// @brief Pulse width for all the tests
+    static constexpr float width = 0.5f;
+
+    unsigned octave = 0;
+
+    /// @brief Fill @ref oscTestSignal from the classic oscillator and time it
+    /// @param freq
+    /// @param shape
+    /// @return CPU cycles per sample
+    static float TestClassic(float freq, float shape)
+    {
+        daisysp::VariableShapeOscillator osc;
+        osc.Init(HW::sampleRate);
+        osc.SetSync(false);
+        osc.SetSyncFreq(freq);
+        osc.SetWaveshape(shape);
+        osc.SetPW(width);
+        // Run for a while first, to get past any start-up transient
+        for (float& x : oscTestSignal) {
+            x = osc.Process();
+        }
+        uint32_t tStart = HW::Sys::GetUs();
+        for (float& x : oscTestSignal) {
+            x = osc.Process();
+        }
+        return CyclesPer(HW::Sys::GetUs() - tStart, oscTestFftSize);
+    }
+
+    /// @brief Fill @ref oscTestSignal from the wavetable oscillator and time it
+    /// @param freq
+    /// @param shape
+    /// @return CPU cycles per sample
+    static float TestWavetable(float freq, float shape)
+    {
+        static constexpr size_t blockSize = HW::audioBlockSize;
+        WavetableOscillator osc;
+        osc.Init(HW::sampleRate);
+        osc.SetFreq(freq);
+        osc.SetShape(shape);
+        osc.SetWidth(width);
+        uint32_t tStart = HW::Sys::GetUs();
+        for (size_t i = 0; i < oscTestFftSize; i += blockSize) {
+            osc.ProcessBlock(std::span(&oscTestSignal[i], blockSize));
+        }
+        return CyclesPer(HW::Sys::GetUs() - tStart, oscTestFftSize);
+    }
+
+    /// @brief Measure the aliasing in @ref oscTestSignal
+    /// @param bin FFT bin of the fundamental
+    /// @return Power of the non-harmonic bins relative to the total, in dB
+    static float AliasDb(unsigned bin)
+    {
+        oscTestFft.Forward(oscTestSignal, oscTestRe, oscTestIm);
+        double total = 0, harmonics = 0;
+        // Skip bin 0, which holds DC and Nyquist
+        for (size_t k = 1; k < oscTestFftSize / 2; ++k) {
+            double power = double(oscTestRe[k]) * oscTestRe[k] + double(oscTestIm[k]) * oscTestIm[k];
+            total += power;
+            if (k % bin == 0) {
+                harmonics += power;
+            }
+        }
+        return float(10 * std::log10((total - harmonics) / total + 1e-30));
+    }
+};
+
+/// @brief @ref tasks::Task that measures the CPU time of the
+/// @ref WavetableUnison oscillator for each number of voices
+/// @details Each time it runs it prints (via serial output) the CPU cycles
+/// per block for 1 to @ref WavetableUnison::maxVoices voices, and that as a
+/// percentage of the time available for each audio callback (one block at the
+/// audio sample rate), to show how many voices fit. The oscillator is set up
+/// afresh for each voice count, as a detuned saw spread across the stereo
+/// field, so every voice is active.
+class UnisonTestTask : public SpeedTestTask
+{
+public:
+    unsigned intervalMicros() const { return 2'000'000; }
+
+    void init() { }
+
+    void execute()
+    {
+        const float budget = float(HW::Sys::GetSysClkFreq()) * float(blockSize) / HW::sampleRate;
+        for (unsigned voices = 1; voices <= WavetableUnison::maxVoices; ++voices) {
+            WavetableUnison osc;
+            osc.Init(HW::sampleRate);
+            osc.SetFreq(110);
+            osc.SetShape(2.f / 3.f);    // saw
+            osc.SetVoices(voices);
+            osc.SetDetune(0.5f);
+            osc.SetSpread(1);
+            uint32_t tStart = HW::Sys::GetUs();
+            for (unsigned block = 0; block < numBlocks; ++block) {
+                osc.ProcessBlock(left, right);
+                sink = left[block % blockSize];
+            }
+            float cycles = CyclesPer(HW::Sys::GetUs() - tStart, numBlocks);
+            auto [cyclesInt, cyclesFrac] = splitFloat(cycles, 1);
+            auto [pctInt, pctFrac] = splitFloat(100 * cycles / budget, 1);
+            daisy2::DebugLog::PrintLine("unison %u voices: cycles/block=%d.%u (%d.%u%% of callback)",
+                voices, cyclesInt, cyclesFrac, pctInt, pctFrac);
+        }
+    }
+
+protected:
+    static constexpr size_t blockSize = HW::audioBlockSize;
+
+    /// @brief Number of blocks for each test
+    static constexpr unsigned numBlocks = 4096;
+
+    float left[blockSize];
+    float right[blockSize];
+};
+
+/// @brief @ref tasks::Task that measures the CPU time saved by the
+/// @ref IdleSkippingDrum voices in @ref ProgSynthDrums
+/// @details Each time it runs it plays one bar of each of a few drum patterns
+/// at 120 BPM, and prints (via serial output) the average CPU cycles per
+/// sample for synthesizing every drum every sample (as ProgSynthDrums did
+/// before) and with idle skipping. The densest pattern keeps all the drums
+/// sounding all the time, so it shows the worst case: the most CPU time any
+/// block can take, which the audio callback still has to allow for. Each
+/// pattern starts with newly initialized drums, so the silent pattern shows
+/// the cost when nothing has been triggered yet.
+class DrumsTestTask : public SpeedTestTask
+{
+public:
+    unsigned intervalMicros() const { return 5'000'000; }
+
+    void init() { }
+
+    void execute()
+    {
+        for (const Pattern& pattern : patterns) {
+            auto [allInt, allFrac] = splitFloat(TestAlways(pattern), 1);
+            auto [skipInt, skipFrac] = splitFloat(TestSkipping(pattern), 1);
+            daisy2::DebugLog::PrintLine("drums %.*s: cycles/sample always=%d.%u skipping=%d.%u",
+                int(pattern.name.size()), pattern.name.data(), allInt, allFrac, skipInt, skipFrac);
+        }
+    }
+
+protected:
+    static constexpr size_t blockSize = HW::audioBlockSize;
+
+    /// @brief Length of a 16th note at 120 BPM, in blocks
+    static constexpr unsigned sixteenthBlocks = unsigned(HW::sampleRate / 8 / blockSize);
+
+    /// @brief Length of the test (one bar), in blocks
+    static constexpr unsigned numBlocks = 16 * sixteenthBlocks;
+
+    /// @brief Drum pattern: a bit for each 16th note of a bar, for each drum
+    struct Pattern
+    {
+        std::string_view name;
+        uint16_t bass;
+        uint16_t snare;
+        uint16_t hihat;
+
+        /// @brief Check if a drum is triggered at the start of a block
+        static bool Trig(uint16_t drum, unsigned block)
+        {
+            return block % sixteenthBlocks == 0 && (drum >> (block / sixteenthBlocks)) & 1;
+        }
+    };
+
+    static constexpr Pattern patterns[] = {
+        { "silent"sv, 0x0000, 0x0000, 0x0000 },
+        { "sparse"sv, 0x0001, 0x0100, 0x0000 },     // bass on 1, snare on 3
+        { "basic"sv, 0x1111, 0x1010, 0x5555 },      // 4 on the floor, 8th hihats
+        { "dense"sv, 0xFFFF, 0xFFFF, 0xFFFF }       // everything on 16ths
+    };
+
+    /// @brief Time the drums without idle skipping
+    /// @param pattern
+    /// @return CPU cycles per sample
+    float TestAlways(const Pattern& pattern)
+    {
+        daisysp::SyntheticBassDrum bass;
+        daisysp::SyntheticSnareDrum snare;
+        daisysp::HiHat<daisysp::RingModNoise> hihat;
+        bass.Init(HW::sampleRate);
+        snare.Init(HW::sampleRate);
+        hihat.Init(HW::sampleRate);
+        uint32_t tStart = HW::Sys::GetUs();
+        for (unsigned block = 0; block < numBlocks; ++block) {
+            if (Pattern::Trig(pattern.bass, block)) bass.Trig();
+            if (Pattern::Trig(pattern.snare, block)) snare.Trig();
+            if (Pattern::Trig(pattern.hihat, block)) hihat.Trig();
+            for (auto&& out : output) {
+                float b = bass.Process();
+                float s = snare.Process();
+                float h = hihat.Process();
+                out.left = h + b/2;
+                out.right = s + b/2;
+            }
+            sink = output[block % blockSize].left;
+        }
+        return CyclesPer(HW::Sys::GetUs() - tStart, numBlocks * blockSize);
+    }
+
+    /// @brief Time the drums with idle skipping
+    /// @param pattern
+    /// @return CPU cycles per sample
+    float TestSkipping(const Pattern& pattern)
+    {
+        IdleSkippingDrum<daisysp::SyntheticBassDrum> bass;
+        IdleSkippingDrum<daisysp::SyntheticSnareDrum> snare;
+        IdleSkippingDrum<daisysp::HiHat<daisysp::RingModNoise>> hihat;
+        bass.Init(HW::sampleRate);
+        snare.Init(HW::sampleRate);
+        hihat.Init(HW::sampleRate);
+        uint32_t tStart = HW::Sys::GetUs();
+        for (unsigned block = 0; block < numBlocks; ++block) {
+            if (Pattern::Trig(pattern.bass, block)) bass.Trig();
+            if (Pattern::Trig(pattern.snare, block)) snare.Trig();
+            if (Pattern::Trig(pattern.hihat, block)) hihat.Trig();
+            float b[blockSize], s[blockSize], h[blockSize];
+            bass.ProcessBlock(b);
+            snare.ProcessBlock(s);
+            hihat.ProcessBlock(h);
+            for (auto&& [out, bOut, sOut, hOut] : std::views::zip(output, b, s, h)) {
+                out.left = hOut + bOut/2;
+                out.right = sOut + bOut/2;
+            }
+            sink = output[block % blockSize].left;
+        }
+        return CyclesPer(HW::Sys::GetUs() - tStart, numBlocks * blockSize);
+    }
+
+    daisy2::AudioSample output[blockSize];
+};
+
+/// @brief Delay time of the feedback loop in @ref DenormalTestTask, in samples
+static constexpr size_t denormalTestDelay = HW::sampleRate / 2;
+
+// BUG: The reverbs and delay buffer should be static data members in
+// DenormalTestTask but then they cannot be stored in SDRAM (DSY_SDRAM_BSS does
+// nothing in that case).
+
+/// @brief Reverbs and delay buffer for @ref DenormalTestTask
+static daisysp::ReverbSc DSY_SDRAM_BSS denormalTestReverbSc;
+static FdnReverb<> DSY_SDRAM_BSS denormalTestFdn;
+static MultiTapDelay<float, denormalTestDelay> DSY_SDRAM_BSS denormalTestDelayBuf;
+
+/// @brief @ref tasks::Task that checks that decaying feedback paths don't get
+/// slower as their signals decay into denormal numbers
+/// @details It feeds an impulse followed by an hour of silence through an
+/// @ref FdnReverb, a daisysp::ReverbSc and a delay feedback loop like
+/// @ref ProgDelay's, processing one second of audio each time it runs. After
+/// each minute of audio it prints (via serial output) the average CPU cycles
+/// per block for each over that minute, and a FAIL line for any that is more
+/// than 10% above its first minute. Then it starts again.
+///
+/// The main loop runs with denormals flushed to zero (see
+/// daisy2::System2::InitFpu), which would hide a missing antiDenormal, so the
+/// loops are timed with flushing turned off. They are timed in the main loop
+/// rather than the audio callback, so their reverbs and delay buffer are
+/// separate from the programs' ones.
+class DenormalTestTask : public SpeedTestTask
+{
+public:
+    unsigned intervalMicros() const { return 1'000'000; }
+
+    void init() { Restart(); }
+
+    void execute()
+    {
+        const bool impulse = (seconds == 0);
+        bool flushToZero = HW::Sys::SetFlushToZero(false);
+        for (size_t engine = 0; engine < numEngines; ++engine) {
+            tMinute[engine] += TestEngine(Engine(engine), impulse);
+        }
+        HW::Sys::SetFlushToZero(flushToZero);
+        ++seconds;
+        if (seconds % 60 == 0) {
+            Report();
+        }
+        if (seconds == testSeconds) {
+            Restart();
+        }
+    }
+
+protected:
+    static constexpr size_t blockSize = HW::audioBlockSize;
+
+    /// @brief Number of blocks processed each time the task runs (one second)
+    static constexpr unsigned numBlocks = HW::sampleRate / blockSize;
+
+    /// @brief Length of the test, in seconds of audio
+    static constexpr unsigned testSeconds = 60 * 60;
+
+    /// @brief Feedback loops under test
+    enum class Engine { Fdn, ReverbSc, Delay };
+    static constexpr size_t numEngines = 3;
+    static constexpr const char* engineNames[numEngines] = { "fdn", "reverbsc", "delay" };
+
+    /// @brief Gain of the delay feedback loop
+    static constexpr float delayFeedback = 0.7f;
+
+    /// @brief Set up the feedback loops with their buffers cleared, and start
+    /// the test again
+    void Restart()
+    {
+        denormalTestFdn.Init(HW::sampleRate, 16);
+        denormalTestFdn.SetFeedback(0.9f);
+        denormalTestReverbSc.Init(HW::sampleRate);
+        denormalTestReverbSc.SetFeedback(0.9f);
+        denormalTestDelayBuf.Init();
+        seconds = 0;
+        std::fill(std::begin(tMinute), std::end(tMinute), 0);
+    }
+
+    /// @brief Time one second of audio through a feedback loop
+    /// @param engine
+    /// @param impulse true to start with an impulse, false for silence
+    /// @return Time in microseconds
+    uint32_t TestEngine(Engine engine, bool impulse)
+    {
+        float input[blockSize] = { };
+        float outL[blockSize], outR[blockSize];
+        uint32_t tStart = HW::Sys::GetUs();
+        for (unsigned block = 0; block < numBlocks; ++block) {
+            input[0] = (impulse && block == 0) ? 1.f : 0.f;
+            switch (engine) {
+            case Engine::Fdn:
+                denormalTestFdn.ProcessBlock(input, outL, outR);
+                break;
+            case Engine::ReverbSc:
+                for (size_t i = 0; i < blockSize; ++i) {
+                    denormalTestReverbSc.Process(input[i], input[i], &outL[i], &outR[i]);
+                }
+                break;
+            case Engine::Delay:
+                // Same feedback path as ProgDelay's normal mode
+                denormalTestDelayBuf.ReadBlock(outL, float(denormalTestDelay), float(denormalTestDelay));
+                for (auto&& [fb, in] : std::views::zip(outL, input)) {
+                    fb = fb * delayFeedback + in + antiDenormal;
+                }
+                denormalTestDelayBuf.WriteBlock(outL);
+                break;
+            }
+            sink = outL[0];
+        }
+        return HW::Sys::GetUs() - tStart;
+    }
+
+    /// @brief Print the results for the last minute
+    void Report()
+    {
+        float cycles[numEngines];
+        for (size_t engine = 0; engine < numEngines; ++engine) {
+            cycles[engine] = CyclesPer(tMinute[engine], 60 * numBlocks);
+            if (seconds == 60) {
+                firstMinute[engine] = cycles[engine];
+            }
+            tMinute[engine] = 0;
+        }
+        auto [fdnInt, fdnFrac] = splitFloat(cycles[0], 1);
+        auto [scInt, scFrac] = splitFloat(cycles[1], 1);
+        auto [delayInt, delayFrac] = splitFloat(cycles[2], 1);
+        daisy2::DebugLog::PrintLine("denormal %u min: cycles/block fdn=%d.%u reverbsc=%d.%u delay=%d.%u",
+            seconds / 60, fdnInt, fdnFrac, scInt, scFrac, delayInt, delayFrac);
+        for (size_t engine = 0; engine < numEngines; ++engine) {
+            if (cycles[engine] > maxSlowdown * firstMinute[engine]) {
+                auto [firstInt, firstFrac] = splitFloat(firstMinute[engine], 1);
+                auto [nowInt, nowFrac] = splitFloat(cycles[engine], 1);
+                daisy2::DebugLog::PrintLine("denormal FAIL: %s slowed down from %d.%u to %d.%u cycles/block"
+                    " as its signal decayed (missing antiDenormal?)",
+                    engineNames[engine], firstInt, firstFrac, nowInt, nowFrac);
+            }
+        }
+    }
+
+    /// @brief Largest allowed ratio of cycles per block to the first minute's
+    static constexpr float maxSlowdown = 1.1f;
+
+    unsigned seconds = 0;                   ///< Seconds of audio processed since the impulse
+    uint32_t tMinute[numEngines] = { };     ///< Time for each loop this minute, in microseconds
+    float firstMinute[numEngines] = { };    ///< Cycles per block in the first minute
+};
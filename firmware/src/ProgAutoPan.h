@@ -19,7 +19,7 @@ public:
 
     void Process(ProcessArgs& args)
     {
-        float cv = HW::CVIn::GetUnipolar(HW::CVIn::Pot).value_or(0.25f);
+        float cv = args.cv.GetUnipolar(HW::CVIn::Pot).value_or(0.25f);
         float lfoFreq = 0.025f + 4.f * cv;
         lfo.SetFreq(lfoFreq);
         float pan = 0;
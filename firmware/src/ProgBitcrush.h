@@ -1,20 +1,187 @@
 #pragma once
 
+/// @brief Bit depth and sample rate reducer for @ref ProgBitcrush
+/// @details Works on a block at a time. The settings are turned into an integer
+/// mask, rounding offset and phase increment when they are set, not for every
+/// sample, so the per-sample work is all integer operations:
+/// - Sample rate: a 32-bit phase accumulator, which takes a new sample each
+///   time it wraps around, and holds it in between
+/// - Bit depth: each new sample is converted to Q15 (16-bit signed fixed
+///   point), the low bits are masked off, and half of the step size is added.
+///   This is a mid-rise quantizer, so the levels are symmetrical about zero
+///   with no DC offset, and 1 bit gives a square wave.
+///
+/// At 1x, each held sample starts on the nearest output sample, so the hold
+/// times jitter unless the crushed rate divides the sample rate, and the
+/// steps have harmonics far above the Nyquist frequency. Both alias down into
+/// the audio band as inharmonic, metallic tones. To reduce that, the crushing
+/// can run 2x or 4x oversampled using @ref HalfBandOversampler, which cuts
+/// the aliasing of the sample-and-hold by about 6dB per doubling. (The
+/// quantization noise from a low bit depth is broadband, so it is only
+/// slightly reduced.) Costs per sample and latencies, on top of the crushing:
+/// - 1x: none
+/// - 2x: 24 multiply-adds, 22.5 samples (0.47ms at 48kHz)
+/// - 4x: 40 multiply-adds, 25.75 samples (0.54ms at 48kHz)
+/// and the crushing itself is done 2x or 4x as many times.
+///
+/// The left input channel is crushed and sent to both output channels.
+class BitCrusher
+{
+public:
+    static constexpr unsigned minBitDepth = 1;
+    static constexpr unsigned maxBitDepth = 16;
+    static constexpr float minRate = 40;
+
+    /// @brief Initialize the bitcrusher
+    /// @param sampleRate
+    void Init(float sampleRate)
+    {
+        this->sampleRate = sampleRate;
+        phase = 0;
+        held = 0;
+        oversampler.Reset();
+        SetBitDepth(bitDepth);
+        SetRate(rate);
+    }
+
+    /// @brief Return the bit depth
+    /// @return
+    unsigned GetBitDepth() const { return bitDepth; }
+
+    /// @brief Set the bit depth
+    /// @param bits Number of bits, including the sign bit
+    void SetBitDepth(unsigned bits)
+    {
+        bitDepth = std::clamp(bits, minBitDepth, maxBitDepth);
+        unsigned shift = maxBitDepth - bitDepth;
+        mask = ~((int32_t(1) << shift) - 1);
+        offset = (int32_t(1) << shift) >> 1;
+    }
+
+    /// @brief Return the crushed sample rate
+    /// @return Sample rate in Hz
+    float GetRate() const { return rate; }
+
+    /// @brief Set the crushed sample rate
+    /// @param hz Sample rate in Hz, up to the audio sample rate
+    void SetRate(float hz)
+    {
+        rate = std::clamp(hz, minRate, sampleRate);
+        // Phase increment as a fraction of 2^32 per (oversampled) sample,
+        // just under 1 at the full rate
+        double processRate = double(sampleRate) * oversampler.GetFactor();
+        double inc = double(rate) / processRate * 4294967296.0;
+        phaseInc = uint32_t(std::min(inc, 4294967295.0));
+    }
+
+    /// @brief Return the oversampling factor
+    /// @return
+    unsigned GetOversampling() const { return oversampler.GetFactor(); }
+
+    /// @brief Set the oversampling factor
+    /// @param factor 1 (no oversampling), 2 or 4
+    void SetOversampling(unsigned factor)
+    {
+        unsigned oldFactor = oversampler.GetFactor();
+        oversampler.SetFactor(factor);
+        if (oversampler.GetFactor() != oldFactor) {
+            SetRate(rate);
+        }
+    }
+
+    /// @brief Return the delay due to oversampling
+    /// @return Delay in samples
+    float GetLatency() const { return oversampler.GetLatency(); }
+
+    /// @brief Process a block of samples
+    /// @param in
+    /// @param out
+    void ProcessBlock(daisy2::AudioInBuf in, daisy2::AudioOutBuf out)
+    {
+        const unsigned factor = oversampler.GetFactor();
+        float mono[maxChunk];
+        float over[maxChunk * HalfBandOversampler::maxFactor];
+        for (size_t start = 0; start < in.size(); start += maxChunk) {
+            const size_t size = std::min(in.size() - start, maxChunk);
+            auto chunk = std::span(mono, size);
+            for (size_t i = 0; i < size; ++i) {
+                mono[i] = in[start + i].left;
+            }
+            if (factor == 1) {
+                Crush(chunk);
+            } else {
+                auto overChunk = std::span(over, size * factor);
+                oversampler.Upsample(chunk, overChunk);
+                Crush(overChunk);
+                oversampler.Downsample(overChunk, chunk);
+            }
+            for (size_t i = 0; i < size; ++i) {
+                out[start + i].left = out[start + i].right = mono[i];
+            }
+        }
+    }
+
+private:
+    /// @brief Crush a block of samples in place
+    /// @param buf
+    void Crush(std::span<float> buf)
+    {
+        // Work on local copies of the state, so the compiler knows the output
+        // stores can't change it and keeps it in registers
+        const int32_t mask = this->mask, offset = this->offset;
+        const uint32_t phaseInc = this->phaseInc;
+        uint32_t phase = this->phase;
+        float held = this->held;
+        for (float& x : buf) {
+            phase += phaseInc;
+            if (phase < phaseInc) {
+                // The phase wrapped around: take a new sample
+                int32_t q15 = int32_t(std::clamp(x, -1.f, q15Max) * 32768.f);
+                held = float((q15 & mask) + offset) * (1.f / 32768.f);
+            }
+            x = held;
+        }
+        this->phase = phase;
+        this->held = held;
+    }
+
+    /// @brief Largest Q15 value, as a float
+    static constexpr float q15Max = 32767.f / 32768.f;
+
+    /// @brief Number of samples processed at a time (at the base rate)
+    static constexpr size_t maxChunk = HW::audioBlockSize;
+
+    float sampleRate = 48000;
+    unsigned bitDepth = 8;
+    float rate = 10000;
+    int32_t mask = -1;          ///< Q15 mask for the bit depth
+    int32_t offset = 0;         ///< Half of the Q15 step size for the bit depth
+    uint32_t phaseInc = 0;      ///< Phase increment per sample for the rate
+    uint32_t phase = 0;
+    float held = 0;             ///< Sample being held
+    HalfBandOversampler oversampler;
+};
+
 /// @brief Bitcrusher @ref Program
-/// @details Bit depth and sample rate are set using the potentiometer.
-/// @todo Flexible CV control of bit depth and sample rate
+/// @details Bit depth and sample rate can each be set by the potentiometer or
+/// a CV input, using @ref BitCrusher. The oversampling setting gives a "clean"
+/// crush with much less aliasing, at a known extra CPU cost and latency (see
+/// @ref BitCrusher).
 class ProgBitcrush : public Program
 {
     using this_t = ProgBitcrush;
 
     // Declare the configurable parameters of this program
     #define PARAM_VALUES(ITEM) \
-        ITEM(BitDepth, "Bit depth") \
-        ITEM(SampleRate, "Sample rate")
-    DECL_PARAM_VALUES(KnobControl)
+        ITEM(Off, "Off") \
+        ITEM(X2, "2x (clean)") \
+        ITEM(X4, "4x (clean)")
+    DECL_PARAM_VALUES(Oversampling)
     #undef PARAM_VALUES
     #define PROG_PARAMS(ITEM) \
-        PARAM_NUM(ITEM, KnobControl, "Knob control", 0)
+        PARAM_CVSOURCE(ITEM, BitDepthControl, "Bit depth ctrl.", Pot) \
+        PARAM_CVSOURCE(ITEM, RateControl, "Rate control", Fixed) \
+        PARAM_NUM(ITEM, Oversampling, "Oversampling", unsigned(Oversampling::Off))
     DECL_PROG_PARAMS
     #undef PROG_PARAMS
 
@@ -26,57 +193,45 @@ public:
         theProgram = this;
 
         sampleRate = HW::seed.AudioSampleRate();
-        sampler.Init(GetCrushRate(), sampleRate);
+        crusher.Init(sampleRate);
     }
 
     void Process(ProcessArgs& args) override
     {
-        auto pot = HW::CVIn::GetUnipolar(HW::CVIn::Pot).value_or(0.25f);
-        if (KnobControl(GetKnobControl()) == KnobControl::BitDepth) {
-            unsigned bits = unsigned(std::round(pot * 17.f));
-            SetBitDepth(bits);
-        } else {
-            float rate = pot * sampleRate;
-            SetCrushRate(rate);
-        }
+        // The settings are updated once per block
+        args.cv.GetUnipolar(GetBitDepthControl())
+            .and_then([this](float val) { SetBitDepth(unsigned(std::round(val * 17.f))); return emptyOpt; });
+        args.cv.GetUnipolar(GetRateControl())
+            .and_then([this](float val) { SetCrushRate(val * sampleRate); return emptyOpt; });
 
-        for (auto&& [in, out] : std::views::zip(args.inbuf, args.outbuf)) {
-            if (sampler.Process()) {
-                unsigned bitMask = 0xFFFFu << (16 - GetBitDepth());
-                unsigned sample = std::abs(in.left) * 65536;
-                sample &= bitMask;
-                float flSample = float(sample) / 65536.f;
-                lastSample.left = lastSample.right = std::copysign(flSample, in.left);
-            }
-            out = lastSample;
-        }
+        crusher.SetOversampling(GetOversamplingFactor(Oversampling(GetOversampling())));
+
+        crusher.ProcessBlock(args.inbuf, args.outbuf);
     }
 
     Animation* GetAnimation() const override { return &animation; }
 
 protected:
-    unsigned GetBitDepth() const { return bitDepth; }
+    unsigned GetBitDepth() const { return crusher.GetBitDepth(); }
+
+    void SetBitDepth(unsigned bits) { crusher.SetBitDepth(bits); }
 
-    void SetBitDepth(unsigned bits) { bitDepth = std::clamp(bits, 1u, 16u); }
+    float GetCrushRate() const { return crusher.GetRate(); }
 
-    float GetCrushRate() const { return crushRate; }
+    void SetCrushRate(float rate) { crusher.SetRate(rate); }
 
-    void SetCrushRate(float rate)
+    /// @brief Return the oversampling factor for an oversampling setting
+    /// @param setting
+    /// @return
+    static constexpr unsigned GetOversamplingFactor(Oversampling setting)
     {
-        crushRate = std::clamp(rate, 40.f, sampleRate);
-        sampler.SetFreq(crushRate);
+        return (setting == Oversampling::X4) ? 4 : (setting == Oversampling::X2) ? 2 : 1;
     }
 
 private:
     float sampleRate = 0;
 
-    unsigned bitDepth = 8;
-
-    float crushRate = 10000;
-
-    daisy2::AudioSample lastSample{};
-
-    daisysp::Metro sampler;
+    BitCrusher crusher;
 
 protected:
     static inline this_t* theProgram = nullptr; // for ProgAnimation and DebugTask
@@ -0,0 +1,227 @@
+#pragma once
+
+/// @brief Longest impulse response for ProgConvolve, in seconds
+static constexpr float maxImpulseSecs = 4;
+
+/// @brief Partition size for the convolution: a power of 2, trading latency
+/// (twice this) against CPU time (the multiply-adds per sample are about the
+/// IR length divided by this)
+static constexpr size_t convolverPartitionSize = 1024;
+
+/// @brief Specialized convolver type
+using ImpulseConvolver = PartitionedConvolver<convolverPartitionSize,
+    (size_t(maxImpulseSecs * HW::sampleRate) + convolverPartitionSize - 1) / convolverPartitionSize>;
+
+/// @brief Decay time (to -60dB) of the built-in impulse response used if
+/// there isn't a valid one in QSPI flash, in seconds
+/// @details The built-in IR is the maximum length, so it can be used to measure
+/// the CPU load for every IR length setting.
+static constexpr float synthDecaySecs = 2;
+
+// BUG: convolver and synthImpulse should be static data members in
+// ProgConvolve but then they cannot be stored in SDRAM (DSY_SDRAM_BSS does
+// nothing in that case).
+
+/// @brief Convolver holding the impulse response spectra
+static ImpulseConvolver DSY_SDRAM_BSS convolver;
+
+/// @brief Built-in impulse response
+static float DSY_SDRAM_BSS synthImpulse[ImpulseConvolver::maxLength];
+
+/// @brief Convolution reverb @ref Program
+/// @details Convolves the input with an impulse response (IR) of up to
+/// @ref maxImpulseSecs seconds, using @ref PartitionedConvolver. The IR is
+/// read from QSPI flash at @ref HW::qspiImpulseResponseOffset, where it is
+/// written by tools/ir2qspi.py. If there isn't a valid IR there, a built-in
+/// one (decaying noise) is used.
+///
+/// The IR length parameter uses less of the IR to save CPU time. The wet
+/// signal is delayed by the convolver latency (43ms), which works as a
+/// reverb pre-delay, so the dry signal isn't delayed to match.
+class ProgConvolve : public Program
+{
+    using this_t = ProgConvolve;
+
+    // Declare the configurable parameters of this program
+    #define PARAM_VALUES(ITEM) \
+        ITEM(Secs1, "1 second") \
+        ITEM(Secs2, "2 seconds") \
+        ITEM(Secs4, "4 seconds")
+    DECL_PARAM_VALUES(IrLength)
+    #undef PARAM_VALUES
+    #define PROG_PARAMS(ITEM) \
+        PARAM_NUM(ITEM, IrLength, "IR length", unsigned(IrLength::Secs4)) \
+        PARAM_CVSOURCE(ITEM, MixControl, "Mix control", Pot)
+    DECL_PROG_PARAMS
+    #undef PROG_PARAMS
+
+public:
+    constexpr std::string_view GetName() const override { return "Convolve"sv; }
+
+    void Init() override
+    {
+        theProgram = this; // DEBUG
+
+        sampleRate = HW::seed.AudioSampleRate();
+        convolver.Init();
+        LoadImpulse();
+        irLength = IrLength(GetIrLength());
+        convolver.SetMaxLength(GetLengthSamples(irLength));
+        mix.Init();
+        SetMixLevel(effectMixLevel);
+    }
+
+    void Process(ProcessArgs& args) override
+    {
+        args.cv.GetUnipolar(GetMixControl())
+            .and_then([this](float val) { SetMixLevel(val); return emptyOpt; });
+
+        if (IrLength(GetIrLength()) != irLength) {
+            irLength = IrLength(GetIrLength());
+            convolver.SetMaxLength(GetLengthSamples(irLength));
+        }
+
+        static constexpr size_t maxBlockSize = HW::audioBlockSize;
+        const size_t size = std::min(args.inbuf.size(), maxBlockSize);
+        float input[maxBlockSize], wet[maxBlockSize];
+        for (auto&& [in, inMono] : std::views::zip(args.inbuf, input)) {
+            inMono = in.left;
+        }
+        convolver.ProcessBlock(std::span(input, size), std::span(wet, size));
+
+        mix.StartBlock(size);
+        for (auto&& [in, out, w] : std::views::zip(args.inbuf, args.outbuf, wet)) {
+            mix.Step();
+            out.left = out.right = mix.Mix(in.left, w);
+        }
+
+        // Update the animation display with the last-calculated result
+        auto animIn = args.inbuf.back();
+        auto animOut = args.outbuf.back();
+        animation.SetAmplitude(animOut.left, animIn.left, animOut.right);
+    }
+
+    Animation* GetAnimation() const override { return &animation; }
+
+protected:
+    /// @brief Header of an impulse response stored in QSPI flash
+    /// @details Followed by numSamples mono samples, as little-endian 32-bit
+    /// floats. Must match tools/ir2qspi.py.
+    struct ImpulseHeader
+    {
+        uint32_t magic;         ///< @ref impulseMagic
+        uint32_t sampleRate;    ///< Sample rate in Hz
+        uint32_t numSamples;    ///< Number of samples
+        uint32_t reserved;
+    };
+
+    /// @brief Magic number identifying an impulse response ("DIR1")
+    static constexpr uint32_t impulseMagic = 0x31524944;
+
+    /// @brief Largest number of samples that fit in the QSPI flash area
+    static constexpr size_t maxFlashSamples =
+        (HW::qspiImpulseResponseSize - sizeof(ImpulseHeader)) / sizeof(float);
+
+    /// @brief Return the number of samples for an IR length setting
+    /// @param length
+    /// @return
+    static constexpr size_t GetLengthSamples(IrLength length)
+    {
+        float secs = (length == IrLength::Secs1) ? 1 : (length == IrLength::Secs2) ? 2 : 4;
+        return size_t(secs * HW::sampleRate);
+    }
+
+    /// @brief Load the impulse response from QSPI flash, or the built-in one
+    /// if there isn't a valid one there
+    void LoadImpulse()
+    {
+        auto header = static_cast<const ImpulseHeader*>(
+            HW::seed.qspi.GetData(HW::qspiImpulseResponseOffset));
+        if (header->magic == impulseMagic && header->sampleRate == uint32_t(sampleRate)
+            && header->numSamples > 0 && header->numSamples <= maxFlashSamples) {
+            auto samples = reinterpret_cast<const float*>(header + 1);
+            convolver.SetImpulseResponse(std::span(samples, header->numSamples));
+            irFromFlash = true;
+        } else {
+            SynthesizeImpulse();
+            convolver.SetImpulseResponse(synthImpulse);
+            irFromFlash = false;
+        }
+    }
+
+    /// @brief Fill in the built-in impulse response: white noise with an
+    /// exponential decay, so it sounds like a plain reverb tail
+    void SynthesizeImpulse()
+    {
+        // Decay by 60dB over the decay time
+        static constexpr float decayDb = -60;
+        const float decay = std::pow(10.f, decayDb / 20.f / (synthDecaySecs * sampleRate));
+        // Uniform noise has a power of 1/3, so scale for a total IR power
+        // (the gain for white noise) of 1
+        float gain = std::sqrt(3.f * (1.f - decay * decay));
+        uint32_t seed = 22222;
+        for (float& x : synthImpulse) {
+            // Xorshift random number generator
+            seed ^= seed << 13;
+            seed ^= seed >> 17;
+            seed ^= seed << 5;
+            float noise = float(int32_t(seed)) * (1.f / 2147483648.f);
+            x = noise * gain;
+            gain *= decay;
+        }
+    }
+
+    /// @brief Get the effect mix level
+    /// @return float in [0, 1]
+    float GetMixLevel() const { return effectMixLevel; }
+
+    /// @brief Set the effect mix level
+    /// @param mixLevel float in [0, 1]
+    void SetMixLevel(float mixLevel)
+    {
+        // KLUDGE: Map mixLevel so there's a dead zone at each end, otherwise we
+        // can't get fully-dry and fully-wet with imperfect pot, ADC, etc.
+        mixLevel = rescale(mixLevel, 0.05f, 0.95f, 0.0f, 1.0f);
+        effectMixLevel = mixLevel;
+        mix.SetPos(mixLevel);
+    }
+
+private:
+    float sampleRate = 0;
+
+    IrLength irLength = IrLength::Secs4;    ///< IR length setting in use
+
+    bool irFromFlash = false;       ///< Was the IR loaded from QSPI flash?
+
+    float effectMixLevel = 0.5;
+
+    EqualPowerCrossFade mix;
+
+    /// @brief Animation for this program shows input and output amplitudes
+    static inline AnimAmplitude<3> animation;
+
+protected:
+    static inline this_t* theProgram = nullptr; // DEBUG: for DebugTask
+
+public:
+    friend class DebugTask;
+
+    /// @brief @ref tasks::Task that prints (via serial output) where the
+    /// impulse response came from and how long it is
+    class DebugTask : public tasks::Task
+    {
+    public:
+        unsigned intervalMicros() const { return 1'000'000; }
+
+        void init() { }
+
+        void execute()
+        {
+            if (theProgram) {
+                daisy2::DebugLog::PrintLine("IR %s: %u partitions",
+                    theProgram->irFromFlash ? "flash" : "built-in",
+                    unsigned(convolver.GetPartitions()));
+            }
+        }
+    };
+};
@@ -6,20 +6,49 @@ static constexpr float maxDelaySecs = 10;
 /// @brief Maximum delay time in samples
 static constexpr size_t maxDelaySamples = size_t(maxDelaySecs * HW::sampleRate);
 
-/// @brief Specialized delay-line type
-using DelayLine = daisysp::DelayLine<float, maxDelaySamples>;
+/// @brief Specialized delay buffer type
+using DelayBuffer = MultiTapDelay<float, maxDelaySamples>;
+
+/// @brief Size of the staging buffer for delay buffer reads: one callback's
+/// worth of samples, plus the biggest delay time ramp for the longest tap,
+/// plus slack for interpolation
+static constexpr size_t delayStagingSize = 2 * HW::audioBlockSize + 4;
+
+/// @brief A tap in a multi-tap @ref ProgDelay pattern
+/// @details Declared outside ProgDelay so that Make() can be used in the
+/// constexpr pattern tables there (a class can't call its own member functions
+/// in its constant initializers).
+struct DelayPatternTap
+{
+    float time;     ///< Tap time as a multiple of the delay time
+    float gainL;    ///< Gain into the left output
+    float gainR;    ///< Gain into the right output
+
+    /// @brief Make a tap with a constant-power pan
+    /// @param time Tap time as a multiple of the delay time
+    /// @param level Tap level
+    /// @param pan Pan position in [-1, 1]: -1 = left, 0 = centre, 1 = right
+    /// @return
+    static constexpr DelayPatternTap Make(float time, float level, float pan)
+    {
+        return { time, level * std::sqrt((1 - pan) / 2), level * std::sqrt((1 + pan) / 2) };
+    }
+};
 
-// BUG: DelayLine variables should be static data members in ProgDelay but then
-// it cannot be stored in SDRAM (DSY_SDRAM_BSS does nothing in that case).
+// BUG: delayBuffer and delayStaging should be static data members in ProgDelay
+// but then they cannot be stored in SDRAM/DTCM (DSY_SDRAM_BSS and
+// DTCM_MEM_SECTION do nothing in that case).
 
-/// @brief Delay line for regular delay
-static DelayLine DSY_SDRAM_BSS delayLine1;
+/// @brief Delay buffer shared by all the taps in all modes
+static DelayBuffer DSY_SDRAM_BSS delayBuffer;
 
-/// @brief Delay line for ping-pong delay
-static DelayLine DSY_SDRAM_BSS delayLine2;
+/// @brief Staging buffer in DTCM for delay buffer reads, so the per-sample
+/// interpolation loop doesn't touch SDRAM
+static float DTCM_MEM_SECTION delayStaging[delayStagingSize];
 
 /// @brief Delay/echo @ref Program
-/// @details Implements normal and ping-pong delay. Various parameters can be set
+/// @details Implements normal, ping-pong and multi-tap delay. Every mode is a
+/// set of read taps on a single delay buffer. Various parameters can be set
 /// by the potentiometer or CV inputs. Pushbutton is used for tap tempo.
 class ProgDelay : public Program
 {
@@ -28,7 +57,8 @@ class ProgDelay : public Program
     // Declare the configurable parameters of this program
     #define PARAM_VALUES(ITEM) \
         ITEM(Normal, "Normal") \
-        ITEM(PingPong, "Ping-pong")
+        ITEM(PingPong, "Ping-pong") \
+        ITEM(MultiTap, "Multi-tap")
     DECL_PARAM_VALUES(Mode)
     #undef PARAM_VALUES
     #define PARAM_VALUES(ITEM) \
@@ -39,6 +69,14 @@ class ProgDelay : public Program
         ITEM(Div23, "2:3")
     DECL_PARAM_VALUES(TapDiv)
     #undef PARAM_VALUES
+    #define PARAM_VALUES(ITEM) \
+        ITEM(Quarters, "Quarters") \
+        ITEM(Dotted, "Dotted") \
+        ITEM(Triplets, "Triplets") \
+        ITEM(Swing, "Swing") \
+        ITEM(Scatter, "Scatter")
+    DECL_PARAM_VALUES(Pattern)
+    #undef PARAM_VALUES
     #define PROG_PARAMS(ITEM) \
         PARAM_NUM(ITEM, Mode, "Delay mode", unsigned(Mode::Normal)) \
         PARAM_CVSOURCE(ITEM, DelayControl, "Delay control", Pot) \
@@ -46,7 +84,9 @@ class ProgDelay : public Program
         PARAM_CVSOURCE(ITEM, MixControl, "Mix control", Fixed) \
         PARAM_CVSOURCE(ITEM, ModRateControl, "Mod rate control", Fixed) \
         PARAM_CVSOURCE(ITEM, ModDepthControl, "Mod depth ctrl.", Fixed) \
-        PARAM_NUM(ITEM, TapDiv, "Tap division", unsigned(TapDiv::Div11))
+        PARAM_NUM(ITEM, TapDiv, "Tap division", unsigned(TapDiv::Div11)) \
+        PARAM_NUM(ITEM, Pattern, "Tap pattern", unsigned(Pattern::Quarters)) \
+        PARAM_GATESOURCE(ITEM, ClockSource, "Clock source", Button)
     DECL_PROG_PARAMS
     #undef PROG_PARAMS
 
@@ -57,12 +97,17 @@ public:
     {
         theProgram = this; // DEBUG
 
-        delayLine1.Init();
-        delayLine2.Init();
+        delayBuffer.Init();
+        delayFilter.Init(cvUpdateRate, 1.f, 30.f, 5.f, delaySave);
+        clock.Init(minClockPeriod, maxClockPeriod);
+        clockLocked = false;
+        delayCvHeld = std::nullopt;
         SetDelayCv(delaySave, 0);
+        delayCurrent = delaySamples;
+        fadePos = 1;
         SetFeedbackAmount(feedbackAmount);
 
-        mix.Init(daisysp::CROSSFADE_CPOW);
+        mix.Init();
         SetMixLevel(effectMixLevel);
 
         lfoMod.Init(HW::sampleRate);
@@ -83,25 +128,23 @@ public:
             tapped = true;
         }
 
-        // Delay processing
-        for (auto&& [in, out] : std::views::zip(args.inbuf, args.outbuf)) {
-            float input = in.left;
-            float delayed = delayLine1.Read();
-            float feedback = delayed * feedbackAmount;
-            out.left = mix.Process(input, delayed);
-            if (GetMode() == unsigned(Mode::PingPong)) {
-                // Ping-pong stereo delay: Two delay lines, one for each channel
-                delayLine2.Write(feedback);
-                delayed = delayLine2.Read();
-                feedback = delayed * feedbackAmount;
-                out.right = mix.Process(input, delayed);
-            } else {
-                // Normal delay: Single delay line output on both channels
-                out.right = out.left;
-            }
-            delayLine1.Write(feedback + input);
+        // Start a crossfade if the delay time has jumped too far to ramp. The
+        // new taps start at the new delay time and carry on ramping from there.
+        bool fading = (fadePos < 1);
+        if (!fading && std::abs(delaySamples - delayCurrent) > maxRampPerCallback) {
+            delayFadeFrom = delayCurrent;
+            delayCurrent = delaySamples;
+            fadePos = 0;
+            fading = true;
         }
 
+        // Delay processing - the mode only decides the set of taps, which is
+        // worked out once per callback, not once per sample
+        Tap taps[maxTaps];
+        auto tapList = GetTaps(taps);
+        fading ? ProcessDelay<true>(args, tapList)
+               : ProcessDelay<false>(args, tapList);
+
         // Update the animation display with the last-calculated result
         auto animIn = args.inbuf.back();
         auto animOut = args.outbuf.back();
@@ -113,6 +156,161 @@ public:
     Animation* GetAnimation() const override { return &animation; }
 
 protected:
+    /// @brief Maximum number of read taps
+    static constexpr size_t maxTaps = 8;
+
+    /// @brief A read tap on the delay buffer
+    struct Tap
+    {
+        float time;     ///< Tap time as a multiple of the delay time
+        float gainL;    ///< Gain into the left output
+        float gainR;    ///< Gain into the right output
+        float feedback; ///< Gain back into the delay buffer
+    };
+
+    /// @brief A tap in a multi-tap @ref Pattern
+    using PatternTap = DelayPatternTap;
+
+    // Tap patterns, in order of increasing time. The last tap is always at the
+    // delay time and is the one fed back into the delay buffer.
+    static constexpr PatternTap patternQuarters[] = {
+        PatternTap::Make(0.25f,  0.4f, -0.6f), PatternTap::Make(0.5f,  0.55f, 0.6f),
+        PatternTap::Make(0.75f,  0.7f, -0.3f), PatternTap::Make(1.f,   1.f,   0.f)
+    };
+    static constexpr PatternTap patternDotted[] = {
+        PatternTap::Make(0.375f, 0.5f, -0.7f), PatternTap::Make(0.75f, 0.7f,  0.7f),
+        PatternTap::Make(1.f,    1.f,   0.f)
+    };
+    static constexpr PatternTap patternTriplets[] = {
+        PatternTap::Make(1.f/3,  0.5f, -0.5f), PatternTap::Make(2.f/3, 0.7f,  0.5f),
+        PatternTap::Make(1.f,    1.f,   0.f)
+    };
+    static constexpr PatternTap patternSwing[] = {
+        PatternTap::Make(1.f/6,  0.3f, -0.8f), PatternTap::Make(0.25f, 0.35f, 0.8f),
+        PatternTap::Make(5.f/12, 0.4f, -0.6f), PatternTap::Make(0.5f,  0.5f,  0.6f),
+        PatternTap::Make(2.f/3,  0.55f,-0.4f), PatternTap::Make(0.75f, 0.65f, 0.4f),
+        PatternTap::Make(11.f/12,0.75f,-0.2f), PatternTap::Make(1.f,   1.f,   0.f)
+    };
+    static constexpr PatternTap patternScatter[] = {
+        PatternTap::Make(0.07f,  0.25f, 0.3f), PatternTap::Make(0.19f, 0.5f, -0.9f),
+        PatternTap::Make(0.31f,  0.3f,  0.7f), PatternTap::Make(0.46f, 0.6f, -0.2f),
+        PatternTap::Make(0.58f,  0.35f, 0.9f), PatternTap::Make(0.73f, 0.45f,-0.6f),
+        PatternTap::Make(0.88f,  0.7f,  0.4f), PatternTap::Make(1.f,   1.f,   0.f)
+    };
+
+    /// @brief Return the taps for a multi-tap pattern
+    /// @param pattern
+    /// @return
+    static constexpr std::span<const PatternTap> GetPatternTaps(Pattern pattern)
+    {
+        switch (pattern) {
+        case Pattern::Dotted:   return patternDotted;
+        case Pattern::Triplets: return patternTriplets;
+        case Pattern::Swing:    return patternSwing;
+        case Pattern::Scatter:  return patternScatter;
+        case Pattern::Quarters:
+        default:                return patternQuarters;
+        }
+    }
+
+    /// @brief Work out the set of taps for the current mode and settings
+    /// @param taps Storage for the taps
+    /// @return The taps used, in order of increasing time
+    std::span<const Tap> GetTaps(std::span<Tap, maxTaps> taps) const
+    {
+        const float feedback = feedbackAmount;
+        size_t count = 0;
+        switch (Mode(GetMode())) {
+        case Mode::PingPong:
+            // Equivalent to two delay lines feeding each other: the left
+            // channel is the input delayed once, the right channel is that
+            // delayed again and the loop goes round once every two delays.
+            taps[count++] = { 1.f, 1.f, 0.f, 0.f };
+            taps[count++] = { 2.f, 0.f, feedback, feedback * feedback };
+            break;
+        case Mode::MultiTap:
+            for (auto&& tap : GetPatternTaps(Pattern(GetPattern()))) {
+                taps[count++] = { tap.time, tap.gainL, tap.gainR, 0.f };
+            }
+            taps[count - 1].feedback = feedback;
+            break;
+        case Mode::Normal:
+        default:
+            taps[count++] = { 1.f, 1.f, 1.f, feedback };
+            break;
+        }
+        return taps.first(count);
+    }
+
+    /// @brief Delay processing for one callback's worth of samples
+    /// @details Each tap is read for the whole callback before the next, longest
+    /// time first, so each read walks through the delay buffer in order. Each
+    /// read copies its window of samples from SDRAM to DTCM in one go before
+    /// interpolating. Then the input plus the taps' feedback is written to the
+    /// buffer in one go. The per-callback working buffers are on the stack,
+    /// which is also in DTCM.
+    /// The delay time ramps smoothly from the previous callback's value to
+    /// the current one, one step per sample. If it has jumped too far for
+    /// that, the output crossfades from taps at the old delay time to taps
+    /// at the new one instead, over several callbacks. The new taps keep
+    /// ramping during the crossfade, but by no more than
+    /// @ref maxRampPerCallback per callback; any bigger jump is crossfaded
+    /// once this crossfade has finished.
+    /// @tparam fading true if crossfading between two delay times
+    /// @param args
+    /// @param taps Taps to read, in order of increasing time
+    template<bool fading>
+    void ProcessDelay(ProcessArgs& args, std::span<const Tap> taps)
+    {
+        using Block = std::array<float, HW::audioBlockSize>;
+        Block wetL = { }, wetR = { }, feedback = { };
+        Block tapNew, tapOld, fade;
+        const size_t size = std::min(args.inbuf.size(), HW::audioBlockSize);
+        const float delayTarget = delayCurrent
+            + std::clamp(delaySamples - delayCurrent, -maxRampPerCallback, maxRampPerCallback);
+        auto tapNewBuf = std::span(tapNew).first(size);
+        auto tapOldBuf = std::span(tapOld).first(size);
+
+        if constexpr (fading) {
+            float pos = fadePos;
+            for (auto&& f : fade) {
+                pos = std::min(pos + fadeStep, 1.f);
+                f = pos;
+            }
+            fadePos = pos;
+        }
+
+        for (auto&& tap : std::views::reverse(taps)) {
+            delayBuffer.ReadBlock(tapNewBuf, delayCurrent * tap.time,
+                                  delayTarget * tap.time, delayStaging);
+            if constexpr (fading) {
+                float delayOld = delayFadeFrom * tap.time;
+                delayBuffer.ReadBlock(tapOldBuf, delayOld, delayOld, delayStaging);
+                for (auto&& [delayed, old, f] : std::views::zip(tapNewBuf, tapOld, fade)) {
+                    delayed = old + (delayed - old) * f;
+                }
+            }
+            for (auto&& [delayed, l, r, fb] : std::views::zip(tapNewBuf, wetL, wetR, feedback)) {
+                l += delayed * tap.gainL;
+                r += delayed * tap.gainR;
+                fb += delayed * tap.feedback;
+            }
+        }
+
+        mix.StartBlock(size);
+        for (auto&& [in, out, l, r, fb] :
+                std::views::zip(args.inbuf, args.outbuf, wetL, wetR, feedback)) {
+            float input = in.left;
+            fb += input + antiDenormal;
+            mix.Step();
+            out.left = mix.Mix(input, l);
+            out.right = mix.Mix(input, r);
+        }
+        delayBuffer.WriteBlock(std::span(feedback).first(size));
+
+        delayCurrent = delayTarget;
+    }
+
     /// @brief Update various CV-controlled parameters according to settings
     /// @details This is called once per Process callback, not once per audio sample.
     /// In addition to the input CVs, this also handles the software LFO.
@@ -120,28 +318,65 @@ protected:
     void ReadCv(const ProcessArgs& args)
     {
         // Modulation LFO
-        HW::CVIn::GetUnipolarExp(GetModRateControl())
+        args.cv.GetUnipolarExp(GetModRateControl())
             .and_then([this](float val) { SetModRateCv(val); return emptyOpt; });
-        HW::CVIn::GetUnipolar(GetModDepthControl())
+        args.cv.GetUnipolar(GetModDepthControl())
             .and_then([this](float val) { SetModDepth(val); return emptyOpt; });
         float modVal = lfoMod.Process();
 
+        // Clock input
+        unsigned clockSource = GetClockSource();
+        if (clockSource == HW::CVIn::Button) {
+            // Not following a clock - the button is used for tap tempo
+            clock.Reset();
+        } else {
+            clock.Advance(float(HW::audioBlockSize));
+            if (args.GateOn(clockSource)) {
+                clock.Edge();
+            }
+        }
+
         // CV inputs
-        // Must always call SetDelayCv even if GetUnipolarExp() returns nothing
-        // because modVal must always be processed.
-        auto cv = HW::CVIn::GetUnipolarExp(GetDelayControl());
-        SetDelayCv(cv, modVal);
-        HW::CVIn::GetUnipolar(GetFeedbackControl())
+        // Must always call SetDelayCv or SetDelayClock even if
+        // GetUnipolarExp() returns nothing because modVal must always be
+        // processed.
+        auto cv = args.cv.GetUnipolarExp(GetDelayControl());
+        if (clock.HasPeriod()) {
+            SetDelayClock(modVal);
+            delayCvHeld = cv;
+        } else {
+            SetDelayCv(cv, modVal);
+        }
+        clockLocked = clock.HasPeriod();
+        args.cv.GetUnipolar(GetFeedbackControl())
             .and_then([this](float val) { SetFeedbackAmount(val); return emptyOpt; });
-        HW::CVIn::GetUnipolar(GetMixControl())
+        args.cv.GetUnipolar(GetMixControl())
             .and_then([this](float val) { SetMixLevel(val); return emptyOpt; });
     }
 
-    float delaySamples = 10000; ///< Delay time in samples
+    float delaySamples = 10000; ///< Delay time in samples (target for the current callback)
+
+    float delayCurrent = 10000; ///< Delay time in samples at the end of the previous callback
+                                ///< (of the new taps, while crossfading)
+
+    float delayFadeFrom = 0;    ///< Delay time in samples being crossfaded from
+
+    float fadePos = 1;          ///< Crossfade position: 0 = delayFadeFrom, 1 = delayCurrent
+
+    /// @brief Largest delay time change per callback that is ramped; bigger
+    /// jumps are crossfaded. Ramping changes the pitch of the delayed sound
+    /// and this limits it to between an octave down and a fifth up.
+    static constexpr float maxRampPerCallback = 0.5f * HW::audioBlockSize;
+
+    /// @brief Crossfade increment per sample (about 20ms for the whole fade)
+    static constexpr float fadeStep = 1.f / 1024;
 
     float delaySave = 0.05;     ///< Last-used delay CV value, used to detect changes
 
-    RunningAverage<float, 48> avgDelay; ///< Delay CV smoother-outer to avoid ugliness
+    /// @brief Rate at which the CVs are read (once per callback)
+    static constexpr float cvUpdateRate = float(HW::sampleRate) / HW::audioBlockSize;
+
+    OneEuroFilter delayFilter;  ///< Delay CV smoother-outer to avoid ugliness
 
     /// @brief Return the delay time in samples
     /// @return 
@@ -152,11 +387,19 @@ protected:
     /// @param modVal delay modulation value
     void SetDelayCv(std::optional<float> delay, float modVal)
     {
+        // After following a clock, keep its delay time until the CV moves
+        if (delay && delayCvHeld) {
+            if (std::abs(*delay - *delayCvHeld) < cvTakeoverChange) {
+                delay = std::nullopt;
+            } else {
+                delayCvHeld = std::nullopt;
+            }
+        }
         // Update the current delay value, only if given and only if it has
         // changed sufficiently.
         if (delay) {
             static constexpr float minChange = 0.0001;
-            delay = avgDelay.update(*delay);
+            delay = delayFilter.Process(*delay);
             if (isDifferent(*delay, delaySave, minChange)) {
                 delaySave = *delay;
             }
@@ -167,6 +410,45 @@ protected:
         SetDelaySecs(delaySecs);
     }
 
+    /// @brief Shortest clock period followed, in samples
+    static constexpr float minClockPeriod = 0.02f * HW::sampleRate;
+
+    /// @brief Longest clock period followed, in samples (the delay time can be
+    /// a fraction of the clock period)
+    static constexpr float maxClockPeriod = 3.f * maxDelaySamples;
+
+    TempoTracker clock;         ///< Follows the clock input
+    bool clockLocked = false;   ///< Was the delay time following the clock last callback?
+    OnePoleFilter clockGlide;   ///< Glides the delay time to a new clock tempo
+
+    /// @brief Delay CV value when the clock was last followed, or nothing once
+    /// the CV has moved away from it and taken over again
+    std::optional<float> delayCvHeld;
+
+    /// @brief Change in the delay CV value that takes over from the delay time
+    /// the clock left
+    static constexpr float cvTakeoverChange = 0.02f;
+
+    /// @brief Set the delay time from the clock tempo, with modulation
+    /// @details The delay time is the clock period times the tap division
+    /// ratio, and glides smoothly when the tempo changes. While the clock
+    /// tracker re-acquires after a tempo change it keeps gliding towards the
+    /// period from before the change.
+    /// @param modVal delay modulation value
+    void SetDelayClock(float modVal)
+    {
+        float target = clock.GetPeriod() * GetTapDivRatio();
+        if (!clockLocked) {
+            // Just locked - glide from the current delay time
+            clockGlide.Init(2.f, cvUpdateRate, delaySamples);
+        }
+        float samples = clockGlide.Process(target);
+        // Hold this delay time if the clock stops, until the delay CV moves
+        delaySave = std::min(samples / HW::sampleRate / maxDelaySecs, 1.f);
+        delayFilter.Reset(delaySave);
+        SetDelaySamples(samples + modVal * HW::sampleRate);
+    }
+
     /// @brief Set the delay time in seconds
     /// @param delaySecs 
     void SetDelaySecs(float delaySecs) { SetDelaySamples(delaySecs * HW::sampleRate); }
@@ -175,9 +457,13 @@ protected:
     /// @param samples 
     void SetDelaySamples(float samples)
     {
-        delaySamples = samples;
-        delayLine1.SetDelay(samples);
-        delayLine2.SetDelay(samples);
+        // The delay buffer can't be read less than one callback back, and the
+        // longest tap must fit in the buffer
+        float maxSamples = float(DelayBuffer::maxDelay);
+        if (GetMode() == unsigned(Mode::PingPong)) {
+            maxSamples /= 2;
+        }
+        delaySamples = std::clamp(samples, float(HW::audioBlockSize), maxSamples);
     }
 
     float delayModRate = 5;     ///< Delay time modulation rate
@@ -238,7 +524,7 @@ protected:
 
     float effectMixLevel = 0.5; ///< Effect mix level
 
-    daisysp::CrossFade mix;     ///< Effect mixer
+    EqualPowerCrossFade mix;    ///< Effect mixer
 
     /// @brief Return the effect mix level
     /// @return 
@@ -255,6 +541,22 @@ protected:
         mix.SetPos(mixLevel);
     }
 
+    /// @brief Return the ratio of the delay time to the tap or clock period
+    /// for the tap-division setting
+    /// @return
+    float GetTapDivRatio() const
+    {
+        switch(TapDiv(GetTapDiv())) {
+            using enum TapDiv;
+            case Div31: return 1.f/3.f;
+            case Div21: return 1.f/2.f;
+            case Div32: return 2.f/3.f;
+            case Div23: return 3.f/2.f;
+            case Div11: return 1.f;
+            default:    return 1.f;
+        }
+    }
+
     HW::Sys::timeus_t tTap = 0; ///< Last tap time
 
     /// @brief Handle tap tempo using the pushbutton
@@ -267,16 +569,7 @@ protected:
         } else {
             // Second tap - Set the delay time. Make it fixed (not CV-controlled)
             // and adjust for the tap-division setting.
-            float delaySecs = (tNow - tTap) / 1e6f;
-            switch(TapDiv(GetTapDiv())) {
-                using enum TapDiv;
-                case Div31: delaySecs /= 3.f;       break;
-                case Div21: delaySecs /= 2.f;       break;
-                case Div32: delaySecs *= 2.f/3.f;   break;
-                case Div23: delaySecs *= 3.f/2.f;   break;
-                case Div11: break;
-                default:    break;
-            }
+            float delaySecs = (tNow - tTap) / 1e6f * GetTapDivRatio();
             if (delaySecs <= maxDelaySecs) {
                 SetDelayControl(HW::CVIn::Fixed);
                 SetDelaySecs(delaySecs);
@@ -4,8 +4,10 @@
 #include "ProgVarOsc.h"
 #include "ProgAutoPan.h"
 #include "ProgSynthDrums.h"
+#include "ProgSampleDrums.h"
 #include "ProgDelay.h"
 #include "ProgReverb.h"
+#include "ProgConvolve.h"
 #include "ProgBitcrush.h"
 #include "ProgQuant.h"
 
@@ -49,11 +51,18 @@ public:
     // DEBUG
     static unsigned GetResetSampleCount() { return sampleCount.exchange(0); }
 
+    /// @brief Return the CPU load meter for the processing callback
+    /// @details Used for benchmarking Programs. See @ref CpuLoadTask.
+    /// @return 
+    static daisy::CpuLoadMeter& GetCpuLoadMeter() { return cpuLoadMeter; }
+
     /// @brief Audio processing callback that calls the current @ref Program
     /// @param inbuf Audio input buffer
     /// @param outbuf Audio output buffer
     static void ProcessingCallback(daisy2::AudioInBuf inbuf, daisy2::AudioOutBuf outbuf)
     {
+        cpuLoadMeter.OnBlockStart();
+
         // Update the gate inputs at the sample rate
         // TODO: Use the analog watchdog feature to make gates interrupt-driven
         // like switches are
@@ -65,6 +74,8 @@ public:
             currentProgram->Process(args);
             /*DEBUG*/sampleCount += std::size(outbuf);
         }
+
+        cpuLoadMeter.OnBlockEnd();
     }
 
 protected:
@@ -81,15 +92,20 @@ protected:
 
     // DEBUG
     static inline std::atomic<unsigned> sampleCount = 0;
+
+    /// @brief Measures the time spent in @ref ProcessingCallback
+    static inline daisy::CpuLoadMeter cpuLoadMeter;
 };
 
 /// @brief List of available programs
 using ProgramList = ProgramListBase<
     ProgVariableOsc
     ,ProgSynthDrums
+    ,ProgSampleDrums
     ,ProgAutoPan
     ,ProgDelay
     ,ProgReverb
+    ,ProgConvolve
     ,ProgBitcrush
     ,ProgQuant
 >;
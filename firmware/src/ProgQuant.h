@@ -3,7 +3,13 @@
 /// @brief Quantizer program
 /// @details This is a CV processor that quantizes the pitch CV on input CV1 to
 /// a given scale and outputs it on output CV1.
-/// @todo Moar scales!
+///
+/// The scale can be any set of notes in the octave: one of a library of
+/// common scales and modes, or a user scale made of the notes selected by the
+/// "User scale" parameters. Either way it is transposed to the selected key.
+/// Whenever the scale or key changes a table of the nearest scale note for
+/// every half semitone is rebuilt, so quantizing a note is just a table
+/// lookup, whatever the scale.
 class ProgQuant : public Program
 {
     using this_t = ProgQuant;
@@ -13,13 +19,36 @@ class ProgQuant : public Program
         ITEM(None, "Untouched") \
         ITEM(Chromatic, "Chromatic") \
         ITEM(Major, "Major / Ionian") \
-        ITEM(Minor, "Minor / Aeolian")
-        // etc.
+        ITEM(Minor, "Minor / Aeolian") \
+        ITEM(Dorian, "Dorian") \
+        ITEM(Phrygian, "Phrygian") \
+        ITEM(Lydian, "Lydian") \
+        ITEM(Mixolydian, "Mixolydian") \
+        ITEM(Locrian, "Locrian") \
+        ITEM(HarmonicMinor, "Harmonic minor") \
+        ITEM(MelodicMinor, "Melodic minor") \
+        ITEM(MajorPentatonic, "Major pentatonic") \
+        ITEM(MinorPentatonic, "Minor pentatonic") \
+        ITEM(Blues, "Blues") \
+        ITEM(WholeTone, "Whole tone") \
+        ITEM(User, "User scale")
     DECL_PARAM_VALUES(Scale)
     #undef PARAM_VALUES
     #define PROG_PARAMS(ITEM) \
         PARAM_NUM(ITEM, Scale, "Scale", unsigned(Scale::Major)) \
-        PARAM_KEY(ITEM, Key, "Key", 0)
+        PARAM_KEY(ITEM, Key, "Key", 0) \
+        PARAM_BOOL(ITEM, UserC, "User scale C", true) \
+        PARAM_BOOL(ITEM, UserCx, "User scale C#", false) \
+        PARAM_BOOL(ITEM, UserD, "User scale D", true) \
+        PARAM_BOOL(ITEM, UserDx, "User scale D#", false) \
+        PARAM_BOOL(ITEM, UserE, "User scale E", true) \
+        PARAM_BOOL(ITEM, UserF, "User scale F", true) \
+        PARAM_BOOL(ITEM, UserFx, "User scale F#", false) \
+        PARAM_BOOL(ITEM, UserG, "User scale G", true) \
+        PARAM_BOOL(ITEM, UserGx, "User scale G#", false) \
+        PARAM_BOOL(ITEM, UserA, "User scale A", true) \
+        PARAM_BOOL(ITEM, UserAx, "User scale A#", false) \
+        PARAM_BOOL(ITEM, UserB, "User scale B", true)
     DECL_PROG_PARAMS
     #undef PROG_PARAMS
 
@@ -28,23 +57,31 @@ public:
 
     void Init() override
     {
-        noteSaved = -1;
-        animation.SetScale(Scale(GetScale()), GetKey());
+        noteOut = -1;
+        noteFilter.Init(cvUpdateRate, 1.f, 1.f, 50.f, 69.f);
+        BuildNoteTable(NotesForScale(Scale(GetScale()), GetKey()));
+        animation.SetScale(tableScale);
         animation.SetNote(69);
     }
 
     void Process(ProcessArgs& args) override
     {
-        float note = HW::CVIn::GetNote(HW::CVIn::CV1);
-        // Only quantize if the current pitch is sufficiently different from the
-        // previous one, to reduce "flickering" between adjacent notes.
-        if (IsDifferent(note, noteSaved)) {
-            noteSaved = note;
-            note = Quantize(note);
+        // Smooth the pitch CV to reduce "flickering" between adjacent notes
+        // due to CV noise, then only update the output if the quantized note
+        // has changed and the CV is clearly past the boundary between the
+        // old and new notes.
+        ScaleNotes scaleNotes = NotesForScale(Scale(GetScale()), GetKey());
+        if (scaleNotes != tableScale) {
+            BuildNoteTable(scaleNotes);
+        }
+        float noteIn = noteFilter.Process(args.cv.GetNote(HW::CVIn::CV1));
+        float note = Quantize(noteIn);
+        if (note != noteOut && IsPastBoundary(noteIn, note)) {
+            noteOut = note;
             HW::CVOut::SetNote(HW::CVOut::Channel::ONE, note);
             animation.SetNote(note);
         }
-        animation.SetScale(Scale(GetScale()), GetKey());
+        animation.SetScale(scaleNotes);
     }
 
     Animation* GetAnimation() const override { return &animation; }
@@ -92,20 +129,105 @@ protected:
         N_(C) | N_(D) | N_(Eb) | N_(F) | N_(G) | N_(Ab) | N_(Bb)
     };
 
+    /// @brief The Dorian mode in the key of C
+    static constexpr ScaleNotes scaleDorian = ScaleNotes {
+        N_(C) | N_(D) | N_(Eb) | N_(F) | N_(G) | N_(A) | N_(Bb)
+    };
+
+    /// @brief The Phrygian mode in the key of C
+    static constexpr ScaleNotes scalePhrygian = ScaleNotes {
+        N_(C) | N_(Db) | N_(Eb) | N_(F) | N_(G) | N_(Ab) | N_(Bb)
+    };
+
+    /// @brief The Lydian mode in the key of C
+    static constexpr ScaleNotes scaleLydian = ScaleNotes {
+        N_(C) | N_(D) | N_(E) | N_(Fx) | N_(G) | N_(A) | N_(B)
+    };
+
+    /// @brief The Mixolydian mode in the key of C
+    static constexpr ScaleNotes scaleMixolydian = ScaleNotes {
+        N_(C) | N_(D) | N_(E) | N_(F) | N_(G) | N_(A) | N_(Bb)
+    };
+
+    /// @brief The Locrian mode in the key of C
+    static constexpr ScaleNotes scaleLocrian = ScaleNotes {
+        N_(C) | N_(Db) | N_(Eb) | N_(F) | N_(Gb) | N_(Ab) | N_(Bb)
+    };
+
+    /// @brief A harmonic minor scale in the key of C
+    static constexpr ScaleNotes scaleHarmonicMinor = ScaleNotes {
+        N_(C) | N_(D) | N_(Eb) | N_(F) | N_(G) | N_(Ab) | N_(B)
+    };
+
+    /// @brief A melodic minor scale (ascending) in the key of C
+    static constexpr ScaleNotes scaleMelodicMinor = ScaleNotes {
+        N_(C) | N_(D) | N_(Eb) | N_(F) | N_(G) | N_(A) | N_(B)
+    };
+
+    /// @brief A major pentatonic scale in the key of C
+    static constexpr ScaleNotes scaleMajorPentatonic = ScaleNotes {
+        N_(C) | N_(D) | N_(E) | N_(G) | N_(A)
+    };
+
+    /// @brief A minor pentatonic scale in the key of C
+    static constexpr ScaleNotes scaleMinorPentatonic = ScaleNotes {
+        N_(C) | N_(Eb) | N_(F) | N_(G) | N_(Bb)
+    };
+
+    /// @brief A blues scale in the key of C
+    static constexpr ScaleNotes scaleBlues = ScaleNotes {
+        N_(C) | N_(Eb) | N_(F) | N_(Fx) | N_(G) | N_(Bb)
+    };
+
+    /// @brief The whole tone scale starting on C
+    static constexpr ScaleNotes scaleWholeTone = ScaleNotes {
+        N_(C) | N_(D) | N_(E) | N_(Fx) | N_(Gx) | N_(Ax)
+    };
+
     #undef N_
 
-    float noteSaved = -1; ///< The last note that was quantized
+    /// @brief Highest MIDI note number that can be quantized
+    static constexpr unsigned maxNote = 127;
+
+    /// @brief Number of entries in @ref noteTable: one per half semitone
+    static constexpr unsigned numTableEntries = 2 * (maxNote + 1);
+
+    /// @brief Nearest note in the current scale for each half semitone
+    /// @details Entry k is for notes from k/2 up to (k+1)/2. The boundary
+    /// between two scale notes is halfway between them, so it's always on a
+    /// semitone or half semitone and each entry is entirely on one side of it.
+    uint8_t noteTable[numTableEntries];
+
+    ScaleNotes tableScale = scaleEmpty; ///< The scale noteTable was built for
+
+    float noteOut = -1; ///< The last note that was output
+
+    /// @brief Rate at which the pitch CV is read (once per callback)
+    static constexpr float cvUpdateRate = float(HW::sampleRate) / HW::audioBlockSize;
 
-    /// @brief Are two notes different?
-    /// @details The notes must be sufficiently different to prevent "flickering"
-    /// due to CV noise.
-    /// @param note1 
-    /// @param note2 
-    /// @return 
-    static constexpr bool IsDifferent(float note1, float note2)
+    /// @brief Pitch CV smoother: steady when the CV is steady but follows
+    /// quick note changes within a few milliseconds
+    OneEuroFilter noteFilter;
+
+    /// @brief How far the pitch CV must go past the boundary between two
+    /// notes before the output changes, in semitones
+    /// @details The filter reduces CV noise but can't stop a steady CV that
+    /// is sitting right on a boundary from flipping between two notes.
+    static constexpr float noteHysteresis = 0.1f;
+
+    /// @brief Is a note clearly nearer to a new quantized note than to the
+    /// current output note?
+    /// @param noteIn Unquantized MIDI note number
+    /// @param note The quantized note that noteIn is nearest to
+    /// @return true if noteIn is at least @ref noteHysteresis past the
+    /// boundary halfway between noteOut and note, or if there is no output yet,
+    /// noteOut isn't in the current scale or there is no quantizing
+    bool IsPastBoundary(float noteIn, float note) const
     {
-        static constexpr float minDiff = 0.2f;
-        return isDifferent(note1, note2, minDiff);
+        // The difference in distance from the two notes is twice the
+        // distance from the halfway point
+        return noteOut < 0 || Scale(GetScale()) == Scale::None || Quantize(noteOut) != noteOut
+            || std::abs(noteIn - noteOut) - std::abs(noteIn - note) > 2 * noteHysteresis;
     }
 
     /// @brief Is the given note in the given scale?
@@ -118,8 +240,6 @@ protected:
     }
 
     /// @brief Transpose a scale to a different key
-    /// @details The given scale must be one that can be transposed, i.e. not
-    /// empty or chromatic.
     /// @param scale A scale, as a set of notes
     /// @param key A key given as a semitone number from 0 (C) to 11 (B)
     /// @return The scale transposed to the given key
@@ -132,86 +252,94 @@ protected:
         return ScaleNotes(scaleU);
     }
 
+    /// @brief Return the user scale, as set by the "User scale" parameters
+    /// @return The scale as a @ref ScaleNotes, in the key of C
+    ScaleNotes UserScale() const
+    {
+        const bool userNotes[numSemis] = {
+            GetUserC(), GetUserCx(), GetUserD(), GetUserDx(), GetUserE(), GetUserF(),
+            GetUserFx(), GetUserG(), GetUserGx(), GetUserA(), GetUserAx(), GetUserB()
+        };
+        uint16_t notes = 0;
+        for (unsigned semi = 0; semi < numSemis; ++semi) {
+            notes |= uint16_t(userNotes[semi]) << semi;
+        }
+        return ScaleNotes(notes);
+    }
+
     /// @brief Return a scale of the given type in the given key
     /// @details The key will be ignored if it's not relevant (e.g. chromatic scale)
     /// @param scale A scale, as a @ref Scale parameter value
     /// @param key A key given as a semitone number from 0 (C) to 11 (B)
     /// @return The scale as a @ref ScaleNotes, transposed to the given key if necessary
-    static constexpr ScaleNotes NotesForScale(Scale scale, unsigned key)
+    ScaleNotes NotesForScale(Scale scale, unsigned key) const
     {
         ScaleNotes notes;
         switch (scale) {
-        case Scale::None:       notes = scaleEmpty;     break;
-        case Scale::Chromatic:  notes = scaleChromatic; break;
-        case Scale::Major:      notes = scaleMajor;     break;
-        case Scale::Minor:      notes = scaleMinor;     break;
-        default:                notes = scaleEmpty;     break;
+        case Scale::None:               notes = scaleEmpty;             break;
+        case Scale::Chromatic:          notes = scaleChromatic;         break;
+        case Scale::Major:              notes = scaleMajor;             break;
+        case Scale::Minor:              notes = scaleMinor;             break;
+        case Scale::Dorian:             notes = scaleDorian;            break;
+        case Scale::Phrygian:           notes = scalePhrygian;          break;
+        case Scale::Lydian:             notes = scaleLydian;            break;
+        case Scale::Mixolydian:         notes = scaleMixolydian;        break;
+        case Scale::Locrian:            notes = scaleLocrian;           break;
+        case Scale::HarmonicMinor:      notes = scaleHarmonicMinor;     break;
+        case Scale::MelodicMinor:       notes = scaleMelodicMinor;      break;
+        case Scale::MajorPentatonic:    notes = scaleMajorPentatonic;   break;
+        case Scale::MinorPentatonic:    notes = scaleMinorPentatonic;   break;
+        case Scale::Blues:              notes = scaleBlues;             break;
+        case Scale::WholeTone:          notes = scaleWholeTone;         break;
+        case Scale::User:               notes = UserScale();            break;
+        default:                        notes = scaleEmpty;             break;
         }
         notes = TransposeScale(notes, key);
         return notes;
     }
 
-    /// @brief Quantize a note by adjusting its pitch so that it is in tune with
-    /// the currently-selected scale
-    /// @param note A MIDI note number (may be fractional)
-    /// @return A MIDI note number that is in the current scale
-    float Quantize(float note)
+    /// @brief Fill in @ref noteTable for a scale
+    /// @details An empty scale (e.g. a user scale with no notes) is treated
+    /// as chromatic, rounding to the nearest semitone.
+    /// @param scale A scale, as a set of notes
+    void BuildNoteTable(ScaleNotes scale)
     {
-        Scale scale = Scale(GetScale());
-        switch (scale) {
-        case Scale::None:
-            note = note; // There.
-            break;
-        case Scale::Chromatic:
-            note = QuantizeSemitone(note);
-            break;
-        case Scale::Major:
-        case Scale::Minor:
-        // TODO: MORE
-            note = QuantizeScale(note, NotesForScale(scale, GetKey()));
-            break;
+        tableScale = scale;
+        if (scale == scaleEmpty) {
+            scale = scaleChromatic;
+        }
+        for (unsigned k = 0; k < numTableEntries; ++k) {
+            // Find the nearest scale notes at or below and above the semitone
+            // at the bottom of this entry. There can be no scale notes below
+            // it, but there are always some above it.
+            const unsigned semi = k / 2;
+            int noteLo = int(semi);
+            while (noteLo >= 0 && !IsInScale(unsigned(noteLo), scale)) {
+                --noteLo;
+            }
+            unsigned noteHi = semi + 1;
+            while (!IsInScale(noteHi, scale)) {
+                ++noteHi;
+            }
+            // Choose the one nearest the middle of the entry
+            const float mid = (float(k) + 0.5f) / 2;
+            noteTable[k] = uint8_t((noteLo >= 0 && mid - float(noteLo) < float(noteHi) - mid)
+                                   ? unsigned(noteLo) : noteHi);
         }
-        return note;
     }
 
-    /// @brief Quantize a note so it is in the chromatic scale
-    /// @details This could be done by QuantizeScale but this way is simpler
-    /// and faster.
-    /// @param note A MIDI note number (may be fractional)
-    /// @return A MIDI note number that is in the scale
-    static float QuantizeSemitone(float note) { return std::round(note); }
-
-    /// @brief Quantize a note so it is in the given scale
+    /// @brief Quantize a note by adjusting its pitch so that it is in tune with
+    /// the currently-selected scale
+    /// @details Uses @ref noteTable, which must be up to date.
     /// @param note A MIDI note number (may be fractional)
-    /// @param scale A scale, as a set of notes
-    /// @return A MIDI note number that is in the scale
-    static float QuantizeScale(float note, ScaleNotes scale)
+    /// @return A MIDI note number that is in the current scale
+    float Quantize(float note) const
     {
-        note = std::max(note, 0.f); // min supported MIDI note number == 0
-        unsigned noteU = unsigned(std::round(note));
-        // Make sure the scale contains any notes, otherwise loops won't terminate
-        if (scale == scaleEmpty) {
-            // arbitrary return value for empty scale
-            return float(noteU);
-        } else {
-            unsigned noteHi;
-            for (noteHi = noteU; !IsInScale(noteHi, scale); ++noteHi)
-                ;
-            float diffHi = noteHi - note;
-            unsigned noteLo = 0;
-            float diffLo;
-            if (noteU == 0) {
-                // this case isn't handled by the loop below
-                diffLo = float(std::numeric_limits<unsigned>::max());
-            } else {
-                noteLo = noteU;
-                do {
-                    --noteLo;
-                } while (!IsInScale(noteLo, scale) && noteLo != 0);
-                diffLo = note - noteLo;
-            }
-            return float((diffHi < diffLo) ? noteHi : noteLo);
+        if (Scale(GetScale()) == Scale::None) {
+            return note;
         }
+        const float index = std::clamp(2 * note, 0.f, float(numTableEntries - 1));
+        return float(noteTable[unsigned(index)]);
     }
 
     /// @brief @ref Animation for @ref ProgQuant
@@ -239,29 +367,22 @@ protected:
             return true;
         }
 
-        void SetScale(Scale scale, unsigned key)
-        {
-            currentScale = scale;
-            currentKey = key;
-        }
+        void SetScale(ScaleNotes scale) { currentScale = scale; }
 
         void SetNote(float note) { noteOut = note; }
 
     protected:
         void DrawScaleHighlights(uint8_t left, uint8_t top)
         {
-            ScaleNotes scaleNotes = NotesForScale(currentScale, currentKey);
             for (unsigned semi = 0; semi < numSemis; ++semi) {
-                if (IsInScale(semi, scaleNotes)) {
+                if (IsInScale(semi, currentScale)) {
                     Graphics::HighlightKey(semi, left, top);
                 }
             }
         }
 
     protected:
-        Scale currentScale = Scale::None;
-
-        unsigned currentKey = 0;
+        ScaleNotes currentScale = scaleEmpty;
 
         float noteOut = 0;
     };
@@ -5,13 +5,37 @@
 /// stored in SDRAM (DSY_SDRAM_BSS does nothing in that case).
 static daisysp::ReverbSc DSY_SDRAM_BSS reverbSc1;
 
+/// @brief Feedback delay network reverb for ProgReverb
+/// BUG: Should be a static data member in ProgReverb but then it cannot be
+/// stored in SDRAM (DSY_SDRAM_BSS does nothing in that case).
+static FdnReverb<> DSY_SDRAM_BSS fdnReverb;
+
 /// @brief Stereo reverb program
+/// @details The reverb engine is either daisysp::ReverbSc or a feedback delay
+/// network (@ref FdnReverb) with 4, 8 or 16 delay lines, for less or more
+/// echo density and CPU time.
+/// To save more CPU time, the reverb engine can run at half the sample rate,
+/// between a half-band decimator and interpolators. That limits the reverb
+/// to 12kHz, which is plenty for a reverb tail. The dry signal is delayed to
+/// match the filters' delay so dry and wet stay lined up at the mixer.
+/// daisysp::ReverbSc has to be reinitialized when the rate changes, which is
+/// too slow for the audio callback, so @ref ReinitTask does it, and the
+/// reverb is silent until it has finished.
 class ProgReverb : public Program
 {
     using this_t = ProgReverb;
 
     // Declare the configurable parameters of this program
+    #define PARAM_VALUES(ITEM) \
+        ITEM(Classic, "Classic") \
+        ITEM(Fdn4, "FDN 4 lines") \
+        ITEM(Fdn8, "FDN 8 lines") \
+        ITEM(Fdn16, "FDN 16 lines")
+    DECL_PARAM_VALUES(Engine)
+    #undef PARAM_VALUES
     #define PROG_PARAMS(ITEM) \
+        PARAM_NUM(ITEM, Engine, "Reverb engine", unsigned(Engine::Classic)) \
+        PARAM_BOOL(ITEM, HalfRate, "Half-rate reverb", false) \
         PARAM_CVSOURCE(ITEM, FeedbackControl, "Feedback control", Fixed) \
         PARAM_CVSOURCE(ITEM, FilterControl, "Filter control", Fixed) \
         PARAM_CVSOURCE(ITEM, MixControl, "Mix control", Pot)
@@ -26,26 +50,53 @@ public:
         theProgram = this; // DEBUG
 
         sampleRate = HW::seed.AudioSampleRate();
-        reverbSc1.Init(sampleRate);
-        mix.Init(daisysp::CROSSFADE_CPOW);
+        halfRate = GetHalfRate();
+        reinitState = ReinitState::Idle;
+        reverbSc1.Init(GetEngineRate());
+        fdnReverb.Init(GetEngineRate(), GetFdnLines(Engine(GetEngine())));
+        ApplySettings();
+        decimator.Reset();
+        interpolatorL.Reset();
+        interpolatorR.Reset();
+        std::fill(std::begin(dryDelayBuf), std::end(dryDelayBuf), 0.f);
+        dryDelayPos = 0;
+        mix.Init();
         SetMixLevel(effectMixLevel);
     }
 
     void Process(ProcessArgs& args) override
     {
-        HW::CVIn::GetUnipolar(GetFeedbackControl())
+        args.cv.GetUnipolar(GetFeedbackControl())
             .and_then([this](float val) { SetFeedbackAmount(val); return emptyOpt; });
-        HW::CVIn::GetUnipolar(GetFilterControl())
+        args.cv.GetUnipolar(GetFilterControl())
             .and_then([this](float val) { SetFilterCutoff(val); return emptyOpt; });
-        HW::CVIn::GetUnipolar(GetMixControl())
+        args.cv.GetUnipolar(GetMixControl())
             .and_then([this](float val) { SetMixLevel(val); return emptyOpt; });
 
-        float outL, outR;
-        for (auto&& [in, out] : std::views::zip(args.inbuf, args.outbuf)) {
-            float input = in.left;
-            reverbSc1.Process(input, input, &outL, &outR);
-            out.left = mix.Process(input, outL);
-            out.right = mix.Process(input, outR);
+        mix.StartBlock(args.inbuf.size());
+
+        // The engine and rate are checked once per callback, not once per sample
+        if (GetHalfRate() != halfRate) {
+            SetHalfRate(GetHalfRate());
+        }
+        CheckReinit();
+        Engine engine = Engine(GetEngine());
+        if (halfRate) {
+            ProcessHalfRate(args, engine);
+        } else if (engine == Engine::Classic) {
+            const bool ready = IsReverbScReady();
+            float outL = 0, outR = 0;
+            for (auto&& [in, out] : std::views::zip(args.inbuf, args.outbuf)) {
+                float input = in.left;
+                if (ready) {
+                    reverbSc1.Process(input, input, &outL, &outR);
+                }
+                mix.Step();
+                out.left = mix.Mix(input, outL);
+                out.right = mix.Mix(input, outR);
+            }
+        } else {
+            ProcessFdn(args, engine);
         }
 
         // Update the animation display with the last-calculated result
@@ -57,6 +108,140 @@ public:
     Animation* GetAnimation() const override { return &animation; }
 
 protected:
+    /// @brief Reverb processing using the FDN engine
+    /// @param args
+    /// @param engine Which FDN engine
+    void ProcessFdn(ProcessArgs& args, Engine engine)
+    {
+        static constexpr size_t maxBlockSize = HW::audioBlockSize;
+        const size_t size = std::min(args.inbuf.size(), maxBlockSize);
+        float input[maxBlockSize], outL[maxBlockSize], outR[maxBlockSize];
+        for (auto&& [in, inMono] : std::views::zip(args.inbuf, input)) {
+            inMono = in.left;
+        }
+        fdnReverb.SetLines(GetFdnLines(engine));
+        fdnReverb.ProcessBlock(std::span(input, size), std::span(outL, size),
+                               std::span(outR, size));
+        for (auto&& [in, out, l, r] : std::views::zip(args.inbuf, args.outbuf, outL, outR)) {
+            mix.Step();
+            out.left = mix.Mix(in.left, l);
+            out.right = mix.Mix(in.left, r);
+        }
+    }
+
+    /// @brief Reverb processing at half the sample rate
+    /// @param args
+    /// @param engine Which reverb engine
+    void ProcessHalfRate(ProcessArgs& args, Engine engine)
+    {
+        static constexpr size_t maxBlockSize = HW::audioBlockSize;
+        static constexpr size_t maxHalfSize = maxBlockSize / 2;
+        static_assert(maxBlockSize % 2 == 0);
+        const size_t size = std::min(args.inbuf.size(), maxBlockSize) & ~size_t(1);
+        const size_t halfSize = size / 2;
+        float input[maxBlockSize], outL[maxBlockSize], outR[maxBlockSize];
+        float halfIn[maxHalfSize], halfL[maxHalfSize], halfR[maxHalfSize];
+        for (auto&& [in, inMono] : std::views::zip(args.inbuf, input)) {
+            inMono = in.left;
+        }
+
+        decimator.ProcessBlock(std::span(input, size), std::span(halfIn, halfSize));
+        if (engine == Engine::Classic) {
+            if (IsReverbScReady()) {
+                for (size_t i = 0; i < halfSize; ++i) {
+                    reverbSc1.Process(halfIn[i], halfIn[i], &halfL[i], &halfR[i]);
+                }
+            } else {
+                std::fill_n(halfL, halfSize, 0.f);
+                std::fill_n(halfR, halfSize, 0.f);
+            }
+        } else {
+            fdnReverb.SetLines(GetFdnLines(engine));
+            fdnReverb.ProcessBlock(std::span(halfIn, halfSize), std::span(halfL, halfSize),
+                                   std::span(halfR, halfSize));
+        }
+        interpolatorL.ProcessBlock(std::span(halfL, halfSize), std::span(outL, size));
+        interpolatorR.ProcessBlock(std::span(halfR, halfSize), std::span(outR, size));
+
+        for (auto&& [in, out, l, r] : std::views::zip(args.inbuf, args.outbuf, outL, outR)) {
+            // Delay the dry signal by as much as the wet signal
+            dryDelayBuf[dryDelayPos] = in.left;
+            float dry = dryDelayBuf[(dryDelayPos - halfRateDelay) & dryDelayMask];
+            dryDelayPos = (dryDelayPos + 1) & dryDelayMask;
+            mix.Step();
+            out.left = mix.Mix(dry, l);
+            out.right = mix.Mix(dry, r);
+        }
+    }
+
+    /// @brief Switch between full-rate and half-rate reverb processing
+    /// @details The rate conversion filters and dry delay are cleared so they
+    /// don't replay old signal. daisysp::ReverbSc has to be reinitialized for
+    /// the new sample rate, which takes far too long for the audio callback,
+    /// so that is left to @ref ReinitTask.
+    /// @param half
+    void SetHalfRate(bool half)
+    {
+        halfRate = half;
+        decimator.Reset();
+        interpolatorL.Reset();
+        interpolatorR.Reset();
+        std::fill(std::begin(dryDelayBuf), std::end(dryDelayBuf), 0.f);
+        dryDelayPos = 0;
+        fdnReverb.SetSampleRate(GetEngineRate());
+        reinitState.store(ReinitState::Pending, std::memory_order_release);
+        ApplySettings();
+    }
+
+    /// @brief Check if @ref ReinitTask has reinitialized daisysp::ReverbSc,
+    /// and if so start using it again
+    /// @details If the rate was changed again while it was being done, it's
+    /// requested again.
+    void CheckReinit()
+    {
+        if (reinitState.load(std::memory_order_acquire) == ReinitState::Done) {
+            if (reinitRate == GetEngineRate()) {
+                reinitState.store(ReinitState::Idle, std::memory_order_relaxed);
+                ApplySettings();
+            } else {
+                reinitState.store(ReinitState::Pending, std::memory_order_release);
+            }
+        }
+    }
+
+    /// @brief Is daisysp::ReverbSc ready to use, i.e. not waiting to be
+    /// reinitialized?
+    /// @return
+    bool IsReverbScReady() const
+    {
+        return reinitState.load(std::memory_order_acquire) == ReinitState::Idle;
+    }
+
+    /// @brief Return the sample rate the reverb engine runs at
+    /// @return
+    float GetEngineRate() const { return halfRate ? sampleRate / 2 : sampleRate; }
+
+    /// @brief Return the number of delay lines for an FDN engine
+    /// @param engine
+    /// @return
+    static constexpr size_t GetFdnLines(Engine engine)
+    {
+        return (engine == Engine::Fdn4) ? 4 : (engine == Engine::Fdn8) ? 8 : 16;
+    }
+
+    /// @brief Pass the current settings to the reverb engines
+    void ApplySettings()
+    {
+        // Keep the cutoff below the engine's Nyquist frequency
+        float cutoff = std::min(filterCutoff, 0.45f * GetEngineRate());
+        if (IsReverbScReady()) {
+            reverbSc1.SetFeedback(feedbackAmount);
+            reverbSc1.SetLpFreq(cutoff);
+        }
+        fdnReverb.SetFeedback(feedbackAmount);
+        fdnReverb.SetLpFreq(cutoff);
+    }
+
     /// @brief Return the feedback amount
     /// @return float in [0, 1]
     float GetFeedbackAmount() const { return feedbackAmount; }
@@ -68,7 +253,7 @@ protected:
     {
         // Map the CV to a range that goes a bit over 1.0
         feedbackAmount = rescale(amount, 0.0f, 0.95f, 0.0f, 1.1f);
-        reverbSc1.SetFeedback(feedbackAmount);
+        ApplySettings();
     }
 
     /// @brief Get the filter cutoff frequency
@@ -80,7 +265,7 @@ protected:
     void SetFilterCutoff(float cutoff)
     {
         filterCutoff = cutoff * (sampleRate / 2);
-        reverbSc1.SetLpFreq(filterCutoff);
+        ApplySettings();
     }
 
     /// @brief Get the effect mix level
@@ -101,22 +286,74 @@ protected:
 private:
     float sampleRate = 0;
 
-    float feedbackAmount = 0.9;
+    // Same defaults as daisysp::ReverbSc
+    float feedbackAmount = 0.97;
+
+    float filterCutoff = 10000;
+
+    bool halfRate = false;          ///< Is the reverb engine running at half rate?
+
+    /// @brief State of reinitializing daisysp::ReverbSc for a new sample rate
+    enum class ReinitState
+    {
+        Idle,       ///< Not needed: ReverbSc can be used
+        Pending,    ///< Requested by the audio callback, for @ref ReinitTask
+        Done        ///< Done by @ref ReinitTask, for the audio callback to check
+    };
 
-    float filterCutoff = 0.5;
+    std::atomic<ReinitState> reinitState = ReinitState::Idle;
+    float reinitRate = 0;           ///< Sample rate ReinitTask used
+
+    HalfBandDecimator<> decimator;
+    HalfBandInterpolator<> interpolatorL;
+    HalfBandInterpolator<> interpolatorR;
+
+    /// @brief Delay of the decimator and interpolator together, in samples
+    /// @details One less than the sum of the two because the decimator output
+    /// is aligned with the later of each pair of input samples
+    static constexpr size_t halfRateDelay =
+        HalfBandDecimator<>::delay + HalfBandInterpolator<>::delay - 1;
+
+    static constexpr size_t dryDelaySize = std::bit_ceil(halfRateDelay + 1);
+    static constexpr size_t dryDelayMask = dryDelaySize - 1;
+    float dryDelayBuf[dryDelaySize];    ///< Dry signal delay for half-rate mode
+    size_t dryDelayPos = 0;
 
     float effectMixLevel = 0.5;
 
-    daisysp::CrossFade mix;
+    EqualPowerCrossFade mix;
 
     /// @brief Animation for this program shows input and output amplitudes
     static inline AnimAmplitude<3> animation;
 
 protected:
-    static inline this_t* theProgram = nullptr; // DEBUG: for DebugTask
+    static inline this_t* theProgram = nullptr; ///< For DebugTask and ReinitTask
 
 public:
     friend class DebugTask;
+    friend class ReinitTask;
+
+    /// @brief @ref tasks::Task that reinitializes daisysp::ReverbSc for a new
+    /// sample rate when the audio callback asks for it
+    /// @details This clears all of its delay memory in SDRAM, which takes far
+    /// longer than an audio callback, so it's done in the main loop instead.
+    class ReinitTask : public tasks::Task
+    {
+    public:
+        unsigned intervalMicros() const { return 10'000; }
+
+        void init() { }
+
+        void execute()
+        {
+            if (theProgram
+                && theProgram->reinitState.load(std::memory_order_acquire) == ReinitState::Pending) {
+                theProgram->reinitRate = theProgram->GetEngineRate();
+                reverbSc1.Init(theProgram->reinitRate);
+                theProgram->reinitState.store(ReinitState::Done, std::memory_order_release);
+            }
+        }
+    };
 
     /// @brief @ref tasks::Task that prints some info (via serial output)
     class DebugTask : public tasks::Task
@@ -0,0 +1,260 @@
+#pragma once
+
+/// @brief Number of voices for ProgSampleDrums: how many samples can play at
+/// once
+static constexpr size_t sampleDrumVoices = 8;
+
+/// @brief Largest number of samples in a sample bank
+static constexpr size_t maxBankSamples = 8;
+
+/// @brief Length of the built-in samples used if there isn't a valid sample
+/// bank in QSPI flash, in seconds
+static constexpr float builtInSampleSecs = 0.5f;
+
+/// @brief Number of built-in samples: bass drum, snare drum and hihat
+static constexpr size_t numBuiltInSamples = 3;
+
+// BUG: builtInSamples should be a static data member in ProgSampleDrums but
+// then it cannot be stored in SDRAM (DSY_SDRAM_BSS does nothing in that case).
+
+/// @brief Built-in samples
+static int16_t DSY_SDRAM_BSS
+    builtInSamples[numBuiltInSamples][size_t(builtInSampleSecs * HW::sampleRate)];
+
+/// @brief Sample playback drums @ref Program
+/// @details Plays one-shot samples from a sample bank in QSPI flash at
+/// @ref HW::qspiSampleBankOffset, where it is written by tools/samples2qspi.py.
+/// The samples are read in place through the memory-mapped QSPI interface,
+/// not copied to RAM, using a @ref SamplePlayer. If there isn't a valid bank
+/// there, a built-in kit of synthesized samples is used.
+///
+/// There are three drums, each with a gate source and a choice of sample
+/// from the bank. Each trigger starts the sample on a free voice, so a drum
+/// can overlap itself, and up to @ref sampleDrumVoices samples can play at
+/// once. The pitch control sets the playback speed (+/- 1 octave) of each
+/// sample when it is triggered.
+class ProgSampleDrums : public Program
+{
+    using this_t = ProgSampleDrums;
+
+    // Declare the configurable parameters of this program
+    #define PARAM_VALUES(ITEM) \
+        ITEM(Sample1, "1") \
+        ITEM(Sample2, "2") \
+        ITEM(Sample3, "3") \
+        ITEM(Sample4, "4") \
+        ITEM(Sample5, "5") \
+        ITEM(Sample6, "6") \
+        ITEM(Sample7, "7") \
+        ITEM(Sample8, "8")
+    DECL_PARAM_VALUES(Drum1Sample)
+    DECL_PARAM_VALUES(Drum2Sample)
+    DECL_PARAM_VALUES(Drum3Sample)
+    #undef PARAM_VALUES
+    #define PROG_PARAMS(ITEM) \
+        PARAM_GATESOURCE(ITEM, Drum1Gate, "Drum 1 gate", CV1) \
+        PARAM_NUM(ITEM, Drum1Sample, "Drum 1 sample", unsigned(Drum1Sample::Sample1)) \
+        PARAM_GATESOURCE(ITEM, Drum2Gate, "Drum 2 gate", CV2) \
+        PARAM_NUM(ITEM, Drum2Sample, "Drum 2 sample", unsigned(Drum2Sample::Sample2)) \
+        PARAM_GATESOURCE(ITEM, Drum3Gate, "Drum 3 gate", Button) \
+        PARAM_NUM(ITEM, Drum3Sample, "Drum 3 sample", unsigned(Drum3Sample::Sample3)) \
+        PARAM_CVSOURCE(ITEM, PitchControl, "Pitch control", Fixed)
+    DECL_PROG_PARAMS
+    #undef PROG_PARAMS
+
+public:
+    constexpr std::string_view GetName() const override { return "Drums - Sample"sv; }
+
+    void Init() override
+    {
+        theProgram = this; // DEBUG
+
+        player.Init(HW::seed.AudioSampleRate());
+        LoadBank();
+        pitch = 1;
+    }
+
+    void Process(ProcessArgs& args) override
+    {
+        // Pitch control: +/- 1 octave, used for the samples triggered now
+        args.cv.GetUnipolar(GetPitchControl())
+            .and_then([this](float val) { pitch = std::exp2(2 * val - 1); return emptyOpt; });
+
+        // Check for drum triggers
+        if (args.GateOn(GetDrum1Gate()))
+            TrigSample(GetDrum1Sample());
+        if (args.GateOn(GetDrum2Gate()))
+            TrigSample(GetDrum2Sample());
+        if (args.GateOn(GetDrum3Gate()))
+            TrigSample(GetDrum3Sample());
+
+        static constexpr size_t maxBlockSize = HW::audioBlockSize;
+        const size_t size = std::min(args.outbuf.size(), maxBlockSize);
+        float mix[maxBlockSize];
+        player.ProcessBlock(std::span(mix, size));
+        for (auto&& [out, m] : std::views::zip(args.outbuf, mix)) {
+            out.left = out.right = m;
+        }
+
+        // Update the animation display with the last-calculated result
+        animation.SetAmplitude(mix[size-1]);
+    }
+
+    Animation* GetAnimation() const override { return &animation; }
+
+protected:
+    /// @brief Header of a sample bank stored in QSPI flash
+    /// @details Followed by numSamples @ref BankEntry, then the sample values
+    /// as little-endian 16-bit signed integers. Must match tools/samples2qspi.py.
+    struct BankHeader
+    {
+        uint32_t magic;         ///< @ref bankMagic
+        uint32_t sampleRate;    ///< Sample rate of all the samples in Hz
+        uint32_t numSamples;    ///< Number of samples
+        uint32_t reserved;
+    };
+
+    /// @brief Sample bank directory entry
+    struct BankEntry
+    {
+        uint32_t offset;        ///< Offset of the sample values from the start of the bank, in bytes
+        uint32_t length;        ///< Number of sample values
+    };
+
+    /// @brief Magic number identifying a sample bank ("DSB1")
+    static constexpr uint32_t bankMagic = 0x31425344;
+
+    /// @brief Output gain, leaving some headroom for several samples at once
+    static constexpr float outputGain = 0.5f;
+
+    /// @brief Start playing a sample from the bank
+    /// @param index Sample number
+    void TrigSample(unsigned index)
+    {
+        if (index < numSamples) {
+            player.Trig(samples[index], pitch, outputGain);
+        }
+    }
+
+    /// @brief Find the samples in the sample bank in QSPI flash, or use the
+    /// built-in ones if there isn't a valid bank there
+    void LoadBank()
+    {
+        auto bank = static_cast<const uint8_t*>(HW::seed.qspi.GetData(HW::qspiSampleBankOffset));
+        auto header = reinterpret_cast<const BankHeader*>(bank);
+        numSamples = 0;
+        bankFromFlash = false;
+        if (header->magic == bankMagic && header->numSamples > 0
+            && header->numSamples <= maxBankSamples && header->sampleRate > 0) {
+            auto entries = reinterpret_cast<const BankEntry*>(header + 1);
+            bool valid = true;
+            for (unsigned i = 0; i < header->numSamples; ++i) {
+                const BankEntry& entry = entries[i];
+                // Check the entry is inside the flash area and aligned
+                if (entry.offset % alignof(int16_t) != 0 || entry.offset >= HW::qspiSampleBankSize
+                    || entry.length > (HW::qspiSampleBankSize - entry.offset) / sizeof(int16_t)) {
+                    valid = false;
+                    break;
+                }
+                samples[i] = { reinterpret_cast<const int16_t*>(bank + entry.offset),
+                               entry.length, float(header->sampleRate) };
+            }
+            if (valid) {
+                numSamples = header->numSamples;
+                bankFromFlash = true;
+            }
+        }
+        if (!bankFromFlash) {
+            SynthesizeSamples();
+        }
+    }
+
+    /// @brief Use the built-in samples: a bass drum (sine with a falling
+    /// pitch), a snare drum (tone and noise) and a hihat (high-passed noise)
+    /// @details They are synthesized the first time they are needed, which
+    /// takes a while, and kept for next time.
+    void SynthesizeSamples()
+    {
+        const float sampleRate = HW::sampleRate;
+        if (!builtInReady) {
+            SynthesizeBuiltIn();
+            builtInReady = true;
+        }
+        for (size_t i = 0; i < numBuiltInSamples; ++i) {
+            samples[i] = { builtInSamples[i], uint32_t(std::size(builtInSamples[i])), sampleRate };
+        }
+        numSamples = numBuiltInSamples;
+    }
+
+    /// @brief Fill in @ref builtInSamples
+    static void SynthesizeBuiltIn()
+    {
+        const float sampleRate = HW::sampleRate;
+        static constexpr float twoPi = 2 * std::numbers::pi_v<float>;
+        uint32_t seed = 33333;
+        auto noise = [&seed]() {
+            // Xorshift random number generator
+            seed ^= seed << 13;
+            seed ^= seed >> 17;
+            seed ^= seed << 5;
+            return float(int32_t(seed)) * (1.f / 2147483648.f);
+        };
+        auto toQ15 = [](float x) { return int16_t(std::clamp(x, -1.f, 1.f) * 32767.f); };
+
+        float phase = 0;
+        float prevNoise = 0;
+        for (size_t n = 0; n < std::size(builtInSamples[0]); ++n) {
+            const float t = float(n) / sampleRate;
+            // Bass drum: 150Hz falling to 50Hz, 150ms decay
+            phase += twoPi * (50.f + 100.f * std::exp(-t / 0.03f)) / sampleRate;
+            builtInSamples[0][n] = toQ15(std::sin(phase) * std::exp(-t / 0.15f));
+            // Snare drum: 180Hz tone and noise, 60ms decay
+            const float white = noise();
+            builtInSamples[1][n] = toQ15((0.4f * std::sin(twoPi * 180.f * t) + 0.6f * white)
+                                         * std::exp(-t / 0.06f));
+            // Hihat: differentiated (high-passed) noise, 20ms decay
+            builtInSamples[2][n] = toQ15(0.7f * (white - prevNoise) * std::exp(-t / 0.02f));
+            prevNoise = white;
+        }
+    }
+
+private:
+    SamplePlayer<sampleDrumVoices> player;
+
+    OneShotSample samples[maxBankSamples];  ///< Samples in the bank
+    unsigned numSamples = 0;                ///< Number of samples in the bank
+    bool bankFromFlash = false;             ///< Was the bank found in QSPI flash?
+
+    float pitch = 1;                        ///< Playback speed for new samples
+
+    /// @brief Have @ref builtInSamples been synthesized yet?
+    static inline bool builtInReady = false;
+
+    /// @brief Animation for this program shows the output amplitude
+    static inline AnimAmplitude<1> animation;
+
+protected:
+    static inline this_t* theProgram = nullptr; // DEBUG: for DebugTask
+
+public:
+    friend class DebugTask;
+
+    /// @brief @ref tasks::Task that prints (via serial output) where the
+    /// samples came from and how many voices are playing
+    class DebugTask : public tasks::Task
+    {
+    public:
+        unsigned intervalMicros() const { return 1'000'000; }
+
+        void init() { }
+
+        void execute()
+        {
+            if (theProgram) {
+                daisy2::DebugLog::PrintLine("bank %s: %u samples, %u voices playing",
+                    theProgram->bankFromFlash ? "flash" : "built-in",
+                    theProgram->numSamples, unsigned(theProgram->player.GetActiveVoices()));
+            }
+        }
+    };
+};
@@ -3,7 +3,70 @@
 // TODO: Lots more drum settings!
 // TODO: Accent control by CV - but that messes up how the gates and parameters work
 
+/// @brief Drum voice that skips synthesis while it is silent
+/// @details Adds idle tracking to a DaisySP drum (VOICE): it watches the peak
+/// level of the drum's output, and once that has stayed below
+/// @ref idleThreshold for @ref idleHoldSecs the voice is idle. ProcessBlock()
+/// then writes zeros without running the drum, until the next Trig(). The
+/// drum's settings functions are used directly.
+/// @tparam VOICE DaisySP drum class, with Init(), Trig() and Process()
+template<typename VOICE>
+class IdleSkippingDrum : public VOICE
+{
+public:
+    /// @brief Level below which the output counts as silent (-80dB)
+    static constexpr float idleThreshold = 1e-4f;
+
+    /// @brief How long the output must stay silent before the voice is idle,
+    /// in seconds
+    /// @details Longer than a cycle of the lowest drum frequency, so the output
+    /// passing through zero isn't mistaken for silence
+    static constexpr float idleHoldSecs = 0.05f;
+
+    /// @brief Initialize the drum, which starts idle
+    /// @param sampleRate
+    void Init(float sampleRate)
+    {
+        VOICE::Init(sampleRate);
+        holdSamples = unsigned(idleHoldSecs * sampleRate);
+        quietSamples = holdSamples;
+    }
+
+    /// @brief Trigger the drum
+    void Trig()
+    {
+        VOICE::Trig();
+        quietSamples = 0;
+    }
+
+    /// @brief Check if the drum is idle (silent, and not being synthesized)
+    /// @return
+    bool IsIdle() const { return quietSamples >= holdSamples; }
+
+    /// @brief Process a block of samples
+    /// @param out
+    void ProcessBlock(std::span<float> out)
+    {
+        if (IsIdle()) {
+            std::fill(out.begin(), out.end(), 0.f);
+            return;
+        }
+        float peak = 0;
+        for (float& x : out) {
+            x = VOICE::Process();
+            peak = std::max(peak, std::abs(x));
+        }
+        quietSamples = (peak < idleThreshold) ? quietSamples + unsigned(out.size()) : 0;
+    }
+
+private:
+    unsigned holdSamples = 0;   ///< idleHoldSecs in samples
+    unsigned quietSamples = 0;  ///< Number of samples the output has been silent for
+};
+
 /// @brief Synth drums program
+/// @details Each drum is an @ref IdleSkippingDrum, so it costs almost nothing
+/// while it isn't sounding.
 class ProgSynthDrums : public Program
 {
     using this_t = ProgSynthDrums;
@@ -47,7 +110,7 @@ public:
     void Process(ProcessArgs& args) override
     {
         // Update drum settings according to the current potentiometer value
-        auto pot = HW::CVIn::GetUnipolar(HW::CVIn::Pot).value_or(0);
+        auto pot = args.cv.GetUnipolar(HW::CVIn::Pot).value_or(0);
         KnobControl knob = KnobControl(GetKnobControl());
         UpdateHhSettings(knob, pot);
         UpdateBassSettings(knob, pot);
@@ -72,19 +135,21 @@ public:
         }
 
 		// Synth output
-        float bassOut = 0;
-        float snareOut = 0;
-        float hihatOut = 0;
-        for (auto&& out : args.outbuf) {
-            bassOut = bass.Process();
-            snareOut = snare.Process();
-            hihatOut = hihat.Process();
-            out.left = hihatOut + bassOut/2;
-            out.right = snareOut + bassOut/2;
+        static constexpr size_t maxBlockSize = HW::audioBlockSize;
+        const size_t size = std::min(args.outbuf.size(), maxBlockSize);
+        float bassOut[maxBlockSize];
+        float snareOut[maxBlockSize];
+        float hihatOut[maxBlockSize];
+        bass.ProcessBlock(std::span(bassOut, size));
+        snare.ProcessBlock(std::span(snareOut, size));
+        hihat.ProcessBlock(std::span(hihatOut, size));
+        for (auto&& [out, b, s, h] : std::views::zip(args.outbuf, bassOut, snareOut, hihatOut)) {
+            out.left = h + b/2;
+            out.right = s + b/2;
         }
 
         // Update the animation display with the last-calculated result
-        animation.SetAmplitude(hihatOut, bassOut, snareOut);
+        animation.SetAmplitude(hihatOut[size-1], bassOut[size-1], snareOut[size-1]);
     }
 
     // DEBUG
@@ -173,11 +238,11 @@ private:
     }
 
 private:
-    daisysp::HiHat<daisysp::RingModNoise> hihat;
+    IdleSkippingDrum<daisysp::HiHat<daisysp::RingModNoise>> hihat;
 
-    daisysp::SyntheticBassDrum bass;
+    IdleSkippingDrum<daisysp::SyntheticBassDrum> bass;
 
-    daisysp::SyntheticSnareDrum snare;
+    IdleSkippingDrum<daisysp::SyntheticSnareDrum> snare;
 
     /// @brief Animation for this program shows the amplitudes of the drums
     static inline AnimAmplitude<3> animation;
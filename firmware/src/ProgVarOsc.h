@@ -1,12 +1,41 @@
 #pragma once
 
 /// @brief Variable-shape VCO program
+/// @details There are two oscillator engines. The classic one is a
+/// @ref daisysp::VariableShapeOscillator: the shape goes from saw to square
+/// and the width sets the pulse width or the saw/triangle slope. The wavetable
+/// one is a @ref WavetableOscillator: the shape morphs from sine to triangle,
+/// saw and square, and the width skews the wave (pulse width for the square).
+///
+/// With more than one unison voice, a @ref WavetableUnison is used whatever
+/// the engine setting: several detuned copies of the wavetable oscillator,
+/// spread across the stereo field.
 class ProgVariableOsc : public Program
 {
     using this_t = ProgVariableOsc;
 
     // Declare the configurable parameters of this program
+    #define PARAM_VALUES(ITEM) \
+        ITEM(Classic, "Classic") \
+        ITEM(Wavetable, "Wavetable")
+    DECL_PARAM_VALUES(Engine)
+    #undef PARAM_VALUES
+    #define PARAM_VALUES(ITEM) \
+        ITEM(Voices1, "1") \
+        ITEM(Voices2, "2") \
+        ITEM(Voices3, "3") \
+        ITEM(Voices4, "4") \
+        ITEM(Voices5, "5") \
+        ITEM(Voices6, "6") \
+        ITEM(Voices7, "7") \
+        ITEM(Voices8, "8")
+    DECL_PARAM_VALUES(Voices)
+    #undef PARAM_VALUES
     #define PROG_PARAMS(ITEM) \
+        PARAM_NUM(ITEM, Engine, "Osc engine", unsigned(Engine::Classic)) \
+        PARAM_NUM(ITEM, Voices, "Unison voices", unsigned(Voices::Voices1)) \
+        PARAM_CVSOURCE(ITEM, DetuneControl, "Detune control", Fixed) \
+        PARAM_CVSOURCE(ITEM, SpreadControl, "Spread control", Fixed) \
         PARAM_CVSOURCE(ITEM, ShapeControl, "Shape control", Pot) \
         PARAM_CVSOURCE(ITEM, WidthControl, "Width control", Fixed) \
         PARAM_FLOAT(ITEM, ModAmount, "Mod amount", 0)
@@ -20,6 +49,10 @@ protected:
         float freq;     ///< Frequency
         float shape;    ///< Wave shape parameter
         float width;    ///< Pulse width parameter
+        Engine engine;  ///< Oscillator engine
+        unsigned voices;    ///< Number of unison voices
+        float detune;   ///< Unison detune
+        float spread;   ///< Unison stereo spread
     };
 
     /// @brief Update the oscillator settings from the current CV inputs
@@ -27,14 +60,23 @@ protected:
     /// @param pparams 
     void UpdateOscParams(const ProcessArgs& args, OscParams* pparams)
     {
-        pparams->freq = HW::CVIn::GetFreqWithMod(HW::CVIn::CV1, HW::CVIn::CV2, GetModAmount());
-        HW::CVIn::GetUnipolar(GetShapeControl())
+        pparams->engine = Engine(GetEngine());
+        pparams->voices = GetVoices() + 1;
+        pparams->freq = args.cv.GetFreqWithMod(HW::CVIn::CV1, HW::CVIn::CV2, GetModAmount());
+        args.cv.GetUnipolar(GetShapeControl())
             .and_then([pparams](float val) { pparams->shape = val; return emptyOpt; });
-        HW::CVIn::GetUnipolar(GetWidthControl())
+        args.cv.GetUnipolar(GetWidthControl())
             .and_then([pparams](float val) { pparams->width = val; return emptyOpt; });
+        args.cv.GetUnipolar(GetDetuneControl())
+            .and_then([pparams](float val) { pparams->detune = val; return emptyOpt; });
+        args.cv.GetUnipolar(GetSpreadControl())
+            .and_then([pparams](float val) { pparams->spread = val; return emptyOpt; });
     }
 
 protected:
+    /// @brief Number of samples (and display columns) in the waveform display
+    static constexpr unsigned animBufSize = 128;
+
     /// @brief Base class for oscillator implementation
     /// @details There's a subclass for the actual oscillator and a subclass for
     /// waveform display.
@@ -49,9 +91,12 @@ protected:
             self.InitImpl(sampleRate);
             self.osc.Init(sampleRate);
             self.osc.SetSync(false);
+            self.wtOsc.Init(sampleRate);
+            self.unison.Init(sampleRate);
         }
 
-        /// @brief Produce output using a @ref daisysp::VariableShapeOscillator
+        /// @brief Produce output using a @ref daisysp::VariableShapeOscillator,
+        /// a @ref WavetableOscillator or a @ref WavetableUnison
         /// @details Called from @ref Program::Process
         /// @param self "this" object with deduced subclass type
         /// @param args 
@@ -61,6 +106,14 @@ protected:
             // Set the oscillator frequency, either from the CV input or
             // constant for waveform display
             float freq = self.GetFreq(params.freq);
+            if (params.voices > 1) {
+                self.ProcessUnison(args, params, freq);
+                return;
+            }
+            if (params.engine == Engine::Wavetable) {
+                self.ProcessWavetable(args, params, freq);
+                return;
+            }
             // NOTE: VariableShapeOscillator uses SetSyncFreq() instead of SetFreq()
             self.osc.SetSyncFreq(freq);
             // Set the shape parameters
@@ -73,8 +126,60 @@ protected:
         }
 
     protected:
-        /// @brief The oscillator
+        /// @brief Produce output using the @ref WavetableOscillator
+        /// @param args 
+        /// @param params 
+        /// @param freq Frequency
+        void ProcessWavetable(ProcessArgs& args, const OscParams& params, float freq)
+        {
+            wtOsc.SetFreq(freq);
+            wtOsc.SetShape(params.shape);
+            wtOsc.SetWidth(params.width);
+            // Fill the output a chunk at a time (the display uses a bigger
+            // buffer than the audio)
+            static constexpr size_t chunkSize = HW::audioBlockSize;
+            float buf[chunkSize];
+            for (size_t i = 0; i < args.outbuf.size(); i += chunkSize) {
+                auto chunk = std::span(buf, std::min(chunkSize, args.outbuf.size() - i));
+                wtOsc.ProcessBlock(chunk);
+                for (auto&& [x, out] : std::views::zip(chunk, args.outbuf.subspan(i))) {
+                    out.left = out.right = x;
+                }
+            }
+        }
+
+        /// @brief Produce output using the @ref WavetableUnison
+        /// @param args 
+        /// @param params 
+        /// @param freq Frequency
+        void ProcessUnison(ProcessArgs& args, const OscParams& params, float freq)
+        {
+            unison.SetFreq(freq);
+            unison.SetShape(params.shape);
+            unison.SetWidth(params.width);
+            unison.SetVoices(params.voices);
+            unison.SetDetune(params.detune);
+            unison.SetSpread(params.spread);
+            static constexpr size_t chunkSize = HW::audioBlockSize;
+            float bufL[chunkSize], bufR[chunkSize];
+            for (size_t i = 0; i < args.outbuf.size(); i += chunkSize) {
+                const size_t size = std::min(chunkSize, args.outbuf.size() - i);
+                unison.ProcessBlock(std::span(bufL, size), std::span(bufR, size));
+                for (auto&& [l, r, out] : std::views::zip(bufL, bufR, args.outbuf.subspan(i, size))) {
+                    out.left = l;
+                    out.right = r;
+                }
+            }
+        }
+
+        /// @brief The classic oscillator
         daisysp::VariableShapeOscillator osc;
+
+        /// @brief The wavetable oscillator
+        WavetableOscillator wtOsc;
+
+        /// @brief The unison oscillator
+        WavetableUnison unison;
     };
 
     /// @brief Actual oscillator implementation
@@ -105,12 +210,61 @@ protected:
     };
 
     /// @brief @ref Animation for @ref ProgVariableOsc
+    /// @details Shows one cycle of the waveform. It is only synthesized again
+    /// when the oscillator settings change by more than a small threshold, so
+    /// CV noise doesn't cause it, and the display is only redrawn when the
+    /// waveform has changed or the animation has been restarted (when the
+    /// display may have been used for something else). Most of the time a
+    /// step does nothing.
     class ProgAnimation : public Animation
     {
     public:
-        void Init() override { }
+        ProgAnimation() { }
+
+        void Init() override { drawn = false; }
 
         bool Step(unsigned step) override
+        {
+            // Take a copy, since the audio callback updates the settings
+            const OscParams params = oscParams;
+            if (!rendered || Changed(params, renderedParams)) {
+                Render(params);
+                drawn = false;
+            }
+            if (!drawn) {
+                Draw();
+                drawn = true;
+            }
+
+            // never stop
+            return true;
+        }
+
+        /// @brief Set the oscillator parameters to use for animation
+        /// @param oscParamsNew 
+        void SetOscParams(const OscParams& oscParamsNew) { oscParams = oscParamsNew; }
+
+    protected:
+        /// @brief Smallest change of a continuous setting that changes the
+        /// waveform display, as a fraction of its range
+        static constexpr float changeThreshold = 1.f / 256;
+
+        /// @brief Check if the settings have changed enough to synthesize the
+        /// waveform again (the frequency isn't used for the display)
+        /// @param a 
+        /// @param b 
+        /// @return 
+        static bool Changed(const OscParams& a, const OscParams& b)
+        {
+            auto differs = [](float x, float y) { return std::abs(x - y) > changeThreshold; };
+            return a.engine != b.engine || a.voices != b.voices
+                || differs(a.shape, b.shape) || differs(a.width, b.width)
+                || (a.voices > 1 && (differs(a.detune, b.detune) || differs(a.spread, b.spread)));
+        }
+
+        /// @brief Synthesize the waveform and convert it to display rows
+        /// @param params Oscillator settings
+        void Render(const OscParams& params)
         {
             // Set up a phony oscillator to generate a waveform for the display
             oscAnim.Init();
@@ -119,15 +273,23 @@ protected:
             static daisy2::AudioSample outTemp[animBufSize];
             daisy2::AudioOutBuf outbuf(outTemp);
             ProcessArgs args = MakeProcessArgs(inbuf, outbuf);
-            oscAnim.Process(args, oscParams);
+            oscAnim.Process(args, params);
+
+            const unsigned yHalf = HW::display.Height() / 2;
+            for (auto&& [sample, y] : std::views::zip(outbuf, pixelRows)) {
+                float yFl = yHalf - sample.left * yHalf;
+                y = (yFl < 0) ? 0 : uint8_t(std::min(yFl, 255.f));
+            }
+            renderedParams = params;
+            rendered = true;
+        }
 
-            // Display the waveform
+        /// @brief Display the rendered waveform
+        void Draw()
+        {
             HW::display.Fill(false);
-            unsigned yHalf = HW::display.Height() / 2;
             unsigned yPrev = 0;
-            for (auto&& [x, sample] : outbuf | std::views::enumerate) {
-                float yFl = yHalf - sample.left * yHalf;
-                unsigned y = (yFl < 0) ? 0 : unsigned(yFl);
+            for (auto&& [x, y] : pixelRows | std::views::enumerate) {
                 if (x == 0) {
                     HW::display.DrawPixel(x, y, true);
                 } else {
@@ -136,19 +298,16 @@ protected:
                 yPrev = y;
             }
             HW::display.Update();
-
-            // never stop
-            return true;
         }
 
-        /// @brief Set the oscillator parameters to use for animation
-        /// @param oscParamsNew 
-        void SetOscParams(const OscParams& oscParamsNew) { oscParams = oscParamsNew; }
-
-    protected:
         OscParams oscParams;
 
         VarOscAnim oscAnim;
+
+        OscParams renderedParams;       ///< Settings of the rendered waveform
+        uint8_t pixelRows[animBufSize]; ///< Display row for each column
+        bool rendered = false;          ///< Is pixelRows valid?
+        bool drawn = false;             ///< Is pixelRows on the display?
     };
 
 public:
@@ -157,7 +316,8 @@ public:
     void Init() override
     {
         oscImpl.Init();
-        oscParams = { .freq=440, .shape=0.2, .width=0.5 };
+        oscParams = { .freq=440, .shape=0.2, .width=0.5, .engine=Engine::Classic,
+            .voices=1, .detune=0.3, .spread=0.5 };
     }
 
     void Process(ProcessArgs& args) override
@@ -172,9 +332,8 @@ public:
 protected:
     VarOscImpl oscImpl;
 
-    OscParams oscParams = { .freq=220, .shape=0.2, .width=0.5 };
-
-    static constexpr unsigned animBufSize = 128;
+    OscParams oscParams = { .freq=220, .shape=0.2, .width=0.5, .engine=Engine::Classic,
+        .voices=1, .detune=0.3, .spread=0.5 };
 
     static inline ProgAnimation animation;
 };
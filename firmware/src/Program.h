@@ -1,14 +1,20 @@
 #pragma once
 
+/// @brief Snapshot of the CV inputs for one audio callback
+using CVSnapshot = HW::CVIn::Snapshot;
+
 /// @brief Arguments for @ref Program::Process
 /// @details Contains the audio input and output buffers, and also gate on/off
 /// flags because thost have to be calculated a bit carefully.
+/// The CV inputs are read once per callback into @ref cv and Programs should
+/// use that instead of calling the @ref HW::CVIn functions.
 struct ProcessArgs
 {
     daisy2::AudioInBuf inbuf;
     daisy2::AudioOutBuf outbuf;
     bool fGateOn[HW::CVIn::_inCount];
     bool fGateOff[HW::CVIn::_inCount];
+    CVSnapshot cv;
 
     constexpr bool GateOn(unsigned input) const
     {
@@ -130,13 +136,14 @@ public:
     }
 
     /// @brief Construct a @ref ProcessArgs
-    /// @details Contains audio input and output buffers and gate on/off flags
+    /// @details Contains audio input and output buffers, gate on/off flags and
+    /// a snapshot of the CV inputs
     /// @param inbuf Audio input buffer
     /// @param outbuf Audio output buffer
     /// @return 
     static ProcessArgs MakeProcessArgs(daisy2::AudioInBuf inbuf, daisy2::AudioOutBuf outbuf)
     {
-        return {
+        ProcessArgs args = {
             .inbuf = inbuf,
             .outbuf = outbuf,
             .fGateOn = {
@@ -150,6 +157,8 @@ public:
                 HW::button.TurnedOff()
             }
         };
+        args.cv.Take();
+        return args;
     }
 
 protected:
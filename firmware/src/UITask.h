@@ -107,13 +107,17 @@ protected:
     }
 
     static inline bool buttonSaved = false; ///< saved button state
-    static inline unsigned potSaved = 0;    ///< saved potentiometer value
+    static inline uint16_t potSaved = 0;    ///< saved potentiometer value
+
+    /// @brief Pot value smoother, so a smaller change can be detected
+    static inline MovingAverage<uint16_t, 2> potAverage;
 
     /// @brief Save the current button state and pot value so they can be compared later
     static void saveButtonPotValue()
     {
         buttonSaved = HW::button.IsOn();
         potSaved = HW::CVIn::GetRaw(HW::CVIn::Pot);
+        potAverage.Reset(potSaved);
     }
 
     /// @brief Check if the button state or pot value has changed since it was saved
@@ -123,8 +127,8 @@ protected:
         if (HW::button.IsOn() != buttonSaved) {
             return true;
         }
-        static constexpr int minChange = 100;
-        int diff = int(HW::CVIn::GetRaw(HW::CVIn::Pot)) - int(potSaved);
+        static constexpr int minChange = 64;
+        int diff = int(potAverage.Process(HW::CVIn::GetRaw(HW::CVIn::Pot))) - int(potSaved);
         if (std::abs(diff) > minChange) {
             return true;
         }
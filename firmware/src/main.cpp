@@ -1,8 +1,10 @@
 #include <algorithm>
 #include <array>
 #include <atomic>
+#include <bit>
 #include <cmath>
 #include <limits>
+#include <numbers>
 #include <optional>
 #include <ranges>
 #include <span>
@@ -16,10 +18,22 @@ using namespace std::string_view_literals;
 
 #include "daisy_seed2.h"
 #include "daisysp.h"
+#include "util/PersistentStorage.h"
+#include "util/CpuLoadMeter.h"
 #include "tasks.h"
 #include "ringbuf.h"
 #include "datatable.h"
 #include "lookup.h"
+#include "filters.h"
+#include "multitap.h"
+#include "tempo.h"
+#include "fdn.h"
+#include "halfband.h"
+#include "crossfade.h"
+#include "fft.h"
+#include "convolver.h"
+#include "wavetable.h"
+#include "sampleplayer.h"
 
 // Set the type of hardware being used.
 enum class HWType { Prototype, Module };
@@ -33,6 +47,7 @@ enum class HWType { Prototype, Module };
 #include "CVOut.h"
 
 #include "Hardware.h"
+#include "Calibration.h"
 
 #include "Graphics.h"
 #include "Animation.h"
@@ -46,13 +61,23 @@ enum class HWType { Prototype, Module };
 static constexpr tasks::TaskList<
     AnimationTask
     ,UIImpl::UI<ProgramList, programs>::Task
+    ,ProgReverb::ReinitTask
     //,BlinkTask
     //,ButtonLedTask
     //,GateLedTask
     //,AdcOutputTask
     //,AdcCalibrateTask
     //,SampleRateTask
+    //,CpuLoadTask
+    //,LookupTestTask
+    //,DelayTestTask
+    //,BitcrushTestTask
+    //,OscTestTask
+    //,UnisonTestTask
+    //,DrumsTestTask
+    //,DenormalTestTask
     //,ProgReverb::DebugTask
+    //,ProgSampleDrums::DebugTask
 > taskList;
 
 int main()
@@ -60,6 +85,12 @@ int main()
     // Initialize the hardware
     HW::Init();
 
+    // Load the CV calibration settings, or measure new ones if requested
+    Calibration::Init();
+    if (Calibration::IsRequested()) {
+        Calibration::Run();
+    }
+
     // Start audio processing
     HW::StartProcessing(ProgramList::ProcessingCallback);
 
@@ -0,0 +1,63 @@
+""" ir2qspi - Convert a WAV file to an impulse response image for QSPI flash.
+
+Usage: ir2qspi.py [--no-normalize] <wav-filename> <output-filename>
+  <wav-filename> is an integer PCM WAV file (8, 16, 24 or 32 bits). Stereo files
+    are mixed to mono.
+  <output-filename> will be written with the impulse response image
+The impulse response is resampled to 48kHz if necessary (linear interpolation,
+so better to resample it beforehand with a proper tool), truncated to 4 seconds
+and normalized so its total power (its gain for white noise) is 1, unless
+--no-normalize is given.
+
+The image is an ImpulseHeader (see ProgConvolve.h) followed by the samples as
+little-endian 32-bit floats. Write it to QSPI flash at offset 0x400000, e.g.
+with the Daisy bootloader in DFU mode:
+  dfu-util -a 0 -s 0x90400000:leave -D <output-filename>
+"""
+
+import sys
+import os
+import struct
+import math
+
+from wavread import readWavMono
+
+sampleRate = 48000
+maxSeconds = 4
+maxFlashBytes = 0x100000
+magic = 0x31524944  # "DIR1"
+headerFormat = '<4I'
+
+cmdName, *args = sys.argv
+cmdName = os.path.basename(cmdName)
+normalize = True
+if args and args[0] == '--no-normalize':
+    normalize = False
+    args = args[1:]
+if len(args) != 2:
+    print(__doc__)
+    sys.exit(1)
+wavFile, outputFile = args
+
+# Read the WAV file, mix it to mono and resample it
+samples = readWavMono(wavFile, sampleRate, cmdName)
+
+# Truncate and normalize
+maxSamples = maxSeconds * sampleRate
+if len(samples) > maxSamples:
+    print(f'{cmdName}: truncating from {len(samples) / sampleRate:.2f}s to {maxSeconds}s')
+    samples = samples[:maxSamples]
+if normalize:
+    power = sum(x * x for x in samples)
+    if power > 0:
+        gain = 1 / math.sqrt(power)
+        samples = [x * gain for x in samples]
+
+# Write the image
+image = struct.pack(headerFormat, magic, sampleRate, len(samples), 0)
+image += struct.pack(f'<{len(samples)}f', *samples)
+if len(image) > maxFlashBytes:
+    sys.exit(f'{cmdName}: image is too big ({len(image)} bytes)')
+with open(outputFile, 'wb') as file:
+    file.write(image)
+print(f'{cmdName}: wrote {len(samples)} samples ({len(samples) / sampleRate:.2f}s) to {outputFile}')
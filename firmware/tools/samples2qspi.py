@@ -0,0 +1,75 @@
+""" samples2qspi - Convert WAV files to a sample bank image for QSPI flash.
+
+Usage: samples2qspi.py [--no-normalize] <output-filename> <wav-filename>...
+  <output-filename> will be written with the sample bank image
+  <wav-filename> is an integer PCM WAV file (8, 16, 24 or 32 bits), up to 8 of
+    them. Stereo files are mixed to mono. They are numbered 1, 2... in the
+    order given, for the "Drum N sample" settings.
+The samples are resampled to 48kHz if necessary (linear interpolation, so
+better to resample them beforehand with a proper tool) and each one is
+normalized so its peak is full scale, unless --no-normalize is given.
+
+The image is a BankHeader (see ProgSampleDrums.h), a BankEntry for each sample,
+then the samples as little-endian 16-bit signed integers. Write it to QSPI
+flash at offset 0x500000, e.g. with the Daisy bootloader in DFU mode:
+  dfu-util -a 0 -s 0x90500000:leave -D <output-filename>
+"""
+
+import sys
+import os
+import struct
+
+from wavread import readWavMono
+
+sampleRate = 48000
+maxSamples = 8
+maxFlashBytes = 0x2F0000
+magic = 0x31425344  # "DSB1"
+headerFormat = '<4I'
+entryFormat = '<2I'
+
+cmdName, *args = sys.argv
+cmdName = os.path.basename(cmdName)
+normalize = True
+if args and args[0] == '--no-normalize':
+    normalize = False
+    args = args[1:]
+if len(args) < 2 or len(args) > maxSamples + 1:
+    print(__doc__)
+    sys.exit(1)
+outputFile, *wavFiles = args
+
+# Read the samples and convert them to 16 bits
+banks = []
+for wavFile in wavFiles:
+    samples = readWavMono(wavFile, sampleRate, cmdName)
+    if len(samples) < 2:
+        sys.exit(f'{cmdName}: {wavFile} is too short')
+    peak = max(abs(x) for x in samples)
+    if normalize and peak > 0:
+        samples = [x / peak for x in samples]
+    banks.append([max(-32768, min(32767, round(x * 32767))) for x in samples])
+
+# Lay out the image: header, directory, then each sample's values starting on
+# a 4-byte boundary
+offset = struct.calcsize(headerFormat) + len(banks) * struct.calcsize(entryFormat)
+entries = []
+for values in banks:
+    offset = (offset + 3) & ~3
+    entries.append((offset, len(values)))
+    offset += 2 * len(values)
+if offset > maxFlashBytes:
+    sys.exit(f'{cmdName}: image is too big ({offset} bytes, max {maxFlashBytes})')
+
+image = bytearray(offset)
+struct.pack_into(headerFormat, image, 0, magic, sampleRate, len(banks), 0)
+for n, (entryOffset, length) in enumerate(entries):
+    struct.pack_into(entryFormat, image,
+                     struct.calcsize(headerFormat) + n * struct.calcsize(entryFormat),
+                     entryOffset, length)
+    struct.pack_into(f'<{length}h', image, entryOffset, *banks[n])
+with open(outputFile, 'wb') as file:
+    file.write(image)
+for n, (wavFile, (entryOffset, length)) in enumerate(zip(wavFiles, entries)):
+    print(f'{cmdName}: sample {n + 1}: {wavFile}, {length / sampleRate:.2f}s')
+print(f'{cmdName}: wrote {len(banks)} samples ({len(image)} bytes) to {outputFile}')
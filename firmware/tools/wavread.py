@@ -0,0 +1,41 @@
+""" wavread - Shared WAV file reading for the QSPI image tools.
+
+Used by ir2qspi.py and samples2qspi.py.
+"""
+
+import wave
+
+
+def readWavMono(wavFile, sampleRate, cmdName):
+    """ Read an integer PCM WAV file (8, 16, 24 or 32 bits), mix it to mono
+    and resample it to sampleRate if necessary (linear interpolation, so
+    better to resample it beforehand with a proper tool).
+    Returns the samples as a list of floats in [-1, 1).
+    """
+    with wave.open(wavFile, 'rb') as wav:
+        numChannels = wav.getnchannels()
+        sampleWidth = wav.getsampwidth()
+        fileRate = wav.getframerate()
+        data = wav.readframes(wav.getnframes())
+    if sampleWidth == 1:
+        values = [(b - 128) / 128 for b in data]
+    else:
+        scale = 1 / (1 << (8 * sampleWidth - 1))
+        values = [int.from_bytes(data[i:i + sampleWidth], 'little', signed=True) * scale
+                  for i in range(0, len(data), sampleWidth)]
+    samples = [sum(values[i:i + numChannels]) / numChannels
+               for i in range(0, len(values), numChannels)]
+
+    if fileRate != sampleRate:
+        print(f'{cmdName}: {wavFile}: resampling from {fileRate}Hz to {sampleRate}Hz')
+        ratio = fileRate / sampleRate
+        length = int(len(samples) / ratio)
+        resampled = []
+        for n in range(length):
+            pos = n * ratio
+            i = int(pos)
+            frac = pos - i
+            nextSample = samples[i + 1] if i + 1 < len(samples) else 0
+            resampled.append(samples[i] + frac * (nextSample - samples[i]))
+        samples = resampled
+    return samples